@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "arena.h"
+#include "utils.h"
+
+/**
+ * Creates the empty arena. No memory is allocated until the first allocation.
+ *
+ * @param blockSize The size of the blocks to allocate.
+ */
+Arena::Arena(std::size_t blockSize) : _blockSize(std::max<std::size_t>(blockSize, 1)), _blocks(), _current(0), _offset(0), _capacity(0)
+{
+}
+
+Arena::~Arena()
+{
+}
+
+/**
+ * Allocates the memory from the current block or from the new one if the current
+ * block is full. The memory is valid until the arena is reset or destroyed.
+ *
+ * @param size The number of bytes to allocate.
+ * @param alignment The alignment of the memory, power of two.
+ *
+ * @return Pointer to the allocated memory.
+ */
+void* Arena::allocate(std::size_t size, std::size_t alignment)
+{
+	while (_current < _blocks.size())
+	{
+		std::uintptr_t start = reinterpret_cast<std::uintptr_t>(_blocks[_current].data.get());
+		std::size_t offset = static_cast<std::size_t>(alignUp(start + _offset, alignment) - start);
+		if (offset <= _blocks[_current].size && size <= _blocks[_current].size - offset)
+		{
+			_offset = offset + size;
+			return _blocks[_current].data.get() + offset;
+		}
+
+		// Blocks kept by reset are reused before new ones are allocated
+		_current++;
+		_offset = 0;
+	}
+
+	addBlock(std::max(size + alignment, _blockSize));
+	_offset = static_cast<std::size_t>(alignUp(reinterpret_cast<std::uintptr_t>(_blocks.back().data.get()), alignment)
+		- reinterpret_cast<std::uintptr_t>(_blocks.back().data.get()));
+	void* pointer = _blocks.back().data.get() + _offset;
+	_offset += size;
+	return pointer;
+}
+
+/**
+ * Releases all allocations at once. Memory is kept for the next use. If the last use
+ * needed more blocks, they are merged into the single one which fits all of them,
+ * so the same conversion does not allocate anything next time.
+ */
+void Arena::reset()
+{
+	if (_blocks.size() > 1)
+	{
+		std::size_t capacity = _capacity;
+		_blocks.clear();
+		_capacity = 0;
+		addBlock(capacity);
+	}
+
+	_current = 0;
+	_offset = 0;
+}
+
+/**
+ * Returns the number of bytes which the arena holds.
+ *
+ * @return Size of all blocks in bytes.
+ */
+std::size_t Arena::getCapacity() const
+{
+	return _capacity;
+}
+
+void Arena::addBlock(std::size_t size)
+{
+	_blocks.push_back(Block{std::unique_ptr<std::uint8_t[]>(new std::uint8_t[size]), size});
+	_current = _blocks.size() - 1;
+	_capacity += size;
+}
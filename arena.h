@@ -0,0 +1,104 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Size of the blocks which are allocated by the arena, larger allocations get their own block
+const std::size_t ARENA_BLOCK_SIZE = 1024 * 1024;
+
+/**
+ * Monotonic allocator for transient buffers of single conversion. Memory is taken
+ * from large blocks by moving the pointer and it is never freed one by one,
+ * everything is released at once by reset(). Reset keeps the memory, so the arena
+ * can be reused by the next conversion without calling malloc again. The arena
+ * is not thread-safe, buffers of parallel decoding are allocated by the calling thread.
+ */
+class Arena
+{
+public:
+	Arena(std::size_t blockSize = ARENA_BLOCK_SIZE);
+	Arena(const Arena&) = delete;
+	~Arena();
+
+	Arena& operator =(const Arena&) = delete;
+
+	void* allocate(std::size_t size, std::size_t alignment);
+	void reset();
+
+	std::size_t getCapacity() const;
+
+private:
+	struct Block
+	{
+		std::unique_ptr<std::uint8_t[]> data;
+		std::size_t size;
+	};
+
+	void addBlock(std::size_t size);
+
+	std::size_t _blockSize;
+	std::vector<Block> _blocks;
+	std::size_t _current;
+	std::size_t _offset;
+	std::size_t _capacity;
+};
+
+/**
+ * Standard allocator which takes memory from the arena. Without the arena
+ * it falls back to the heap, so containers can be used the same way
+ * with and without the arena. Allocator is moved together with the contents
+ * of the container, so the memory always goes back where it came from.
+ */
+template <typename T> class ArenaAllocator
+{
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator(Arena* arena = nullptr) : _arena(arena) {}
+	template <typename U> ArenaAllocator(const ArenaAllocator<U>& allocator) : _arena(allocator.getArena()) {}
+
+	T* allocate(std::size_t count)
+	{
+		if (_arena == nullptr)
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+
+		return static_cast<T*>(_arena->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* pointer, std::size_t /*count*/)
+	{
+		// Memory of the arena is released only by its reset
+		if (_arena == nullptr)
+			::operator delete(pointer);
+	}
+
+	Arena* getArena() const
+	{
+		return _arena;
+	}
+
+private:
+	Arena* _arena;
+};
+
+template <typename T, typename U> bool operator ==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.getArena() == b.getArena();
+}
+
+template <typename T, typename U> bool operator !=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+	return a.getArena() != b.getArena();
+}
+
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,88 @@
+#include <cstring>
+
+#include "bit_reader.h"
+
+BitReader::BitReader() : _subBlocks(nullptr), _chunkStart(0), _data(nullptr), _size(0), _pos(0), _bits(0), _bitCount(0)
+{
+}
+
+BitReader::BitReader(const std::uint8_t* data, std::size_t size) : _subBlocks(nullptr), _chunkStart(0), _data(data), _size(size), _pos(0), _bits(0), _bitCount(0)
+{
+}
+
+BitReader::BitReader(SubBlockReader* subBlocks) : _subBlocks(subBlocks), _chunkStart(0), _data(nullptr), _size(0), _pos(0), _bits(0), _bitCount(0)
+{
+}
+
+/**
+ * Continues reading from another buffer. Bits which are already buffered
+ * from the previous buffer are read first, so the data can be split
+ * at any byte boundary.
+ *
+ * @param data The next buffer to read.
+ * @param size The size of the next buffer.
+ */
+void BitReader::setData(const std::uint8_t* data, std::size_t size)
+{
+	_chunkStart += _size;
+	_data = data;
+	_size = size;
+	_pos = 0;
+}
+
+/**
+ * Returns the position of the next unread bit in the data. Sub-block size
+ * bytes are not counted.
+ *
+ * @return Bit offset from the start of the data.
+ */
+std::uint64_t BitReader::getBitPos() const
+{
+	return ((_chunkStart + _pos) << 3) - _bitCount;
+}
+
+/**
+ * Fills the accumulator with as many whole bytes as it can hold. Boundaries
+ * are checked only here, once per refill.
+ */
+void BitReader::refill()
+{
+	// Fast path, load whole unaligned word and take only the bytes which fit into accumulator
+	// Bytes are stored in little-endian order, the same as in GIF data stream
+	if (_pos + sizeof(std::uint64_t) <= _size)
+	{
+		std::uint64_t word;
+		memcpy(&word, _data + _pos, sizeof(word));
+		_bits |= word << _bitCount;
+
+		std::uint8_t bytes = (63 - _bitCount) >> 3;
+		_pos += bytes;
+		_bitCount += bytes << 3;
+		return;
+	}
+
+	// Tail of the buffer, load byte by byte and continue with next sub-block if there is any
+	while (_bitCount <= 56)
+	{
+		if (_pos >= _size)
+		{
+			if (_subBlocks == nullptr)
+				break;
+
+			_chunkStart += _size;
+			_pos = _size = 0;
+			if (!_subBlocks->next(_data, _size))
+				break;
+
+			// Whole words can be loaded from the new sub-block
+			if (_size >= sizeof(std::uint64_t))
+			{
+				refill();
+				return;
+			}
+		}
+
+		_bits |= static_cast<std::uint64_t>(_data[_pos++]) << _bitCount;
+		_bitCount += 8;
+	}
+}
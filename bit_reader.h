@@ -0,0 +1,53 @@
+#ifndef BIT_READER_H
+#define BIT_READER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "sub_block_reader.h"
+
+/**
+ * This class reads the stream of LSB-first packed bit fields from the byte buffer
+ * or from the chain of data sub-blocks. Bits are buffered in 64-bit accumulator
+ * which is refilled with whole words, so reading of single value is just shift
+ * and mask. The reader does not own the data.
+ */
+class BitReader
+{
+public:
+	BitReader();
+	BitReader(const std::uint8_t* data, std::size_t size);
+	BitReader(SubBlockReader* subBlocks);
+
+	bool read(std::uint8_t bitCount, std::uint16_t& value)
+	{
+		if (_bitCount < bitCount)
+		{
+			refill();
+			if (_bitCount < bitCount)
+				return false;
+		}
+
+		value = static_cast<std::uint16_t>(_bits & ((1ULL << bitCount) - 1));
+		_bits >>= bitCount;
+		_bitCount -= bitCount;
+		return true;
+	}
+
+	void setData(const std::uint8_t* data, std::size_t size);
+
+	std::uint64_t getBitPos() const;
+
+private:
+	void refill();
+
+	SubBlockReader* _subBlocks;
+	std::uint64_t _chunkStart;
+	const std::uint8_t* _data;
+	std::size_t _size;
+	std::size_t _pos;
+	std::uint64_t _bits;
+	std::uint8_t _bitCount;
+};
+
+#endif
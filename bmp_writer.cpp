@@ -0,0 +1,143 @@
+#include "bmp_writer.h"
+
+/**
+ * Stores the integer into the buffer in little-endian byte order.
+ *
+ * @param buffer The buffer where to store.
+ * @param value The value to store.
+ */
+template <typename T> static void storeLittleEndian(std::uint8_t* buffer, T value)
+{
+	for (std::size_t i = 0; i < sizeof(T); ++i)
+		buffer[i] = static_cast<std::uint8_t>(value >> (i * 8));
+}
+
+/**
+ * Creates the writer into the file.
+ *
+ * @param outputFile The file where to write.
+ * @param arena The arena for the row buffer, heap if nullptr.
+ */
+BmpWriter::BmpWriter(FILE* outputFile, Arena* arena) : _outputFile(outputFile), _outputBuffer(nullptr), _row(arena)
+{
+}
+
+/**
+ * Creates the writer into the memory.
+ *
+ * @param outputBuffer The buffer where to write.
+ * @param arena The arena for the row buffer, heap if nullptr.
+ */
+BmpWriter::BmpWriter(OutputBuffer* outputBuffer, Arena* arena) : _outputFile(nullptr), _outputBuffer(outputBuffer), _row(arena)
+{
+}
+
+/**
+ * Writes BITMAP file header, DIB header and color table at once.
+ *
+ * @param width The width of the image.
+ * @param height The height of the image. Positive for rows written from bottom to top, negative for rows written from top to bottom.
+ * @param bitsPerPixel Color depth, 8 or 24.
+ * @param compression Compression method of pixel data.
+ * @param palette Color table with all 256 colors, nullptr if there is none.
+ * @param dataSize The size of pixel data.
+ *
+ * @return True if everything was written, otherwise false.
+ */
+bool BmpWriter::writeHeader(std::uint16_t width, std::int32_t height, std::uint16_t bitsPerPixel, BmpCompression compression,
+	const Palette* palette, std::uint64_t dataSize)
+{
+	std::size_t paletteSize = palette ? PALETTE_SIZE : 0;
+	std::uint8_t header[BMP_MAX_HEADER_SIZE] = {};
+	std::size_t headerSize = BMP_HEADER_SIZE + paletteSize * 4;
+	std::uint32_t dataOffset = static_cast<std::uint32_t>(headerSize);
+
+	// BITMAP File Header
+	header[0] = 'B'; // Signature
+	header[1] = 'M';
+	storeLittleEndian(&header[2], static_cast<std::uint32_t>(dataOffset + dataSize)); // Size of file in bytes
+	storeLittleEndian(&header[10], dataOffset); // Offset to start pixel data
+
+	// DIB Header
+	storeLittleEndian(&header[14], static_cast<std::uint32_t>(40)); // Size of this header
+	storeLittleEndian(&header[18], static_cast<std::uint32_t>(width)); // Width
+	storeLittleEndian(&header[22], static_cast<std::uint32_t>(height)); // Height
+	storeLittleEndian(&header[26], static_cast<std::uint16_t>(1)); // Must be 1
+	storeLittleEndian(&header[28], bitsPerPixel); // Depth
+	storeLittleEndian(&header[30], static_cast<std::uint32_t>(compression)); // Compression method
+	// Size of pixel data can be zero for uncompressed BMP
+	if (compression != BMP_COMPRESSION_NONE)
+		storeLittleEndian(&header[34], static_cast<std::uint32_t>(dataSize));
+	storeLittleEndian(&header[38], static_cast<std::uint32_t>(0xB13)); // Horizontal pixel per meter
+	storeLittleEndian(&header[42], static_cast<std::uint32_t>(0xB13)); // Vertical pixel per meter
+	storeLittleEndian(&header[46], static_cast<std::uint32_t>(paletteSize)); // Color palette size
+	// Important colors stay zero
+
+	// Color table entries are stored as blue, green, red and reserved zero byte
+	const Color* colors = palette ? palette->getColors() : nullptr;
+	for (std::size_t i = 0; i < paletteSize; ++i)
+	{
+		std::uint8_t* entry = &header[BMP_HEADER_SIZE + i * 4];
+		entry[0] = colors[i].blue;
+		entry[1] = colors[i].green;
+		entry[2] = colors[i].red;
+	}
+
+	// Size of the whole file is known now, so the memory grows only once
+	if (_outputBuffer != nullptr && !_outputBuffer->reserve(static_cast<std::size_t>(dataOffset + dataSize)))
+		return false;
+
+	return writeData(header, headerSize);
+}
+
+/**
+ * Writes single row of 24-bit BMP. Colors are expanded into BGR in the reusable
+ * row buffer together with the padding.
+ *
+ * @param colors Colors of the row.
+ *
+ * @return True if the row was written, otherwise false.
+ */
+bool BmpWriter::writeRow(const ArenaVector<Color>& colors)
+{
+	_row.resize(paddedRowSize(static_cast<std::uint16_t>(colors.size()), 3));
+
+	std::uint8_t* output = _row.data();
+	for (const auto& color : colors)
+	{
+		*output++ = color.blue;
+		*output++ = color.green;
+		*output++ = color.red;
+	}
+
+	return writeData(_row.data(), _row.size());
+}
+
+/**
+ * Writes raw bytes, which are pixel data already laid out as BMP expects them.
+ *
+ * @param data The bytes to write.
+ * @param size The number of bytes.
+ *
+ * @return True if all bytes were written, otherwise false.
+ */
+bool BmpWriter::writeData(const std::uint8_t* data, std::size_t size)
+{
+	if (_outputBuffer != nullptr)
+		return _outputBuffer->write(data, size);
+
+	return fwrite(data, 1, size, _outputFile) == size;
+}
+
+/**
+ * Returns the size of the row in pixel data, which is aligned to 4 bytes.
+ *
+ * @param width The width of the image.
+ * @param bytesPerPixel The number of bytes of single pixel.
+ *
+ * @return The size of the row in bytes.
+ */
+std::size_t BmpWriter::paddedRowSize(std::uint16_t width, std::size_t bytesPerPixel)
+{
+	return alignUp(static_cast<std::size_t>(width) * bytesPerPixel, 4);
+}
@@ -0,0 +1,49 @@
+#ifndef BMP_WRITER_H
+#define BMP_WRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "arena.h"
+#include "output_buffer.h"
+#include "palette.h"
+#include "utils.h"
+
+const std::size_t BMP_HEADER_SIZE = 54;
+
+// Header followed by the color table of all 256 colors
+const std::size_t BMP_MAX_HEADER_SIZE = BMP_HEADER_SIZE + PALETTE_SIZE * 4;
+
+enum BmpCompression
+{
+	BMP_COMPRESSION_NONE = 0,
+	BMP_COMPRESSION_RLE8 = 1
+};
+
+/**
+ * This class writes BMP file piece by piece. Header is written first, then the pixel
+ * data either as whole buffers or row by row in the order in which rows come, so
+ * the whole image never has to be kept in memory. Output goes either into the file
+ * or into the memory of OutputBuffer.
+ */
+class BmpWriter
+{
+public:
+	BmpWriter(FILE* outputFile, Arena* arena = nullptr);
+	BmpWriter(OutputBuffer* outputBuffer, Arena* arena = nullptr);
+
+	bool writeHeader(std::uint16_t width, std::int32_t height, std::uint16_t bitsPerPixel, BmpCompression compression,
+		const Palette* palette, std::uint64_t dataSize);
+	bool writeRow(const ArenaVector<Color>& colors);
+	bool writeData(const std::uint8_t* data, std::size_t size);
+
+	static std::size_t paddedRowSize(std::uint16_t width, std::size_t bytesPerPixel);
+
+private:
+	FILE* _outputFile;
+	OutputBuffer* _outputBuffer;
+	ArenaVector<std::uint8_t> _row;
+};
+
+#endif
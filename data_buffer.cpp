@@ -4,14 +4,14 @@
 #include "data_buffer.h"
 #include "utils.h"
 
-DataValue::DataValue() : _value()
+DataValue::DataValue() : _inline(), _value(), _size(0)
 {
 }
 
-template <typename T> DataValue::DataValue(T value)
+template <typename T> DataValue::DataValue(T value) : _inline(), _value(), _size(sizeof(T))
 {
-	_value.resize(sizeof(T));
-	memcpy(_value.data(), &value, sizeof(T));
+	static_assert(sizeof(T) <= INLINE_SIZE, "Integral value has to fit inline");
+	memcpy(_inline, &value, sizeof(T));
 }
 
 template DataValue::DataValue<std::int8_t>(std::int8_t value);
@@ -23,21 +23,29 @@ template DataValue::DataValue<std::uint16_t>(std::uint16_t value);
 template DataValue::DataValue<std::uint32_t>(std::uint32_t value);
 template DataValue::DataValue<std::uint64_t>(std::uint64_t value);
 
-DataValue::DataValue(const std::string &value) : _value()
+DataValue::DataValue(const std::uint8_t* data, std::size_t size) : _inline(), _value(), _size(0)
 {
-	std::copy(value.begin(), value.end(), std::back_inserter(_value));
+	assign(data, size);
 }
 
-DataValue::DataValue(const std::vector<std::uint8_t> &value) : _value(value)
+DataValue::DataValue(const std::string &value) : _inline(), _value(), _size(0)
 {
+	assign(reinterpret_cast<const std::uint8_t*>(value.data()), value.size());
 }
 
-DataValue::DataValue(const DataValue &dataValue) : _value(dataValue._value)
+DataValue::DataValue(const std::vector<std::uint8_t> &value) : _inline(), _value(), _size(0)
 {
+	assign(value.data(), value.size());
 }
 
-DataValue::DataValue(DataValue &&dataValue) : _value(std::move(dataValue._value))
+DataValue::DataValue(const DataValue &dataValue) : _inline(), _value(), _size(0)
 {
+	assign(dataValue.getData(), dataValue.getSize());
+}
+
+DataValue::DataValue(DataValue &&dataValue) : _inline(), _value(std::move(dataValue._value)), _size(dataValue._size)
+{
+	memcpy(_inline, dataValue._inline, INLINE_SIZE);
 }
 
 DataValue::~DataValue()
@@ -46,7 +54,9 @@ DataValue::~DataValue()
 
 DataValue& DataValue::operator =(DataValue &&dataValue)
 {
+	memcpy(_inline, dataValue._inline, INLINE_SIZE);
 	_value = std::move(dataValue._value);
+	_size = dataValue._size;
 	return *this;
 }
 
@@ -57,7 +67,17 @@ DataValue& DataValue::operator =(DataValue &&dataValue)
  */
 std::size_t DataValue::getSize() const
 {
-	return _value.size();
+	return _size;
+}
+
+/**
+ * Returns the pointer to the bytes of the value.
+ *
+ * @return Pointer to the first byte.
+ */
+const std::uint8_t* DataValue::getData() const
+{
+	return _size <= INLINE_SIZE ? _inline : _value.data();
 }
 
 /**
@@ -72,16 +92,17 @@ bool DataValue::getBool() const
 }
 
 /**
- * Returns the value as integer type.
+ * Returns the value as integer type. Missing bytes of values shorter
+ * than the integer type are zero.
  *
  * @return Integer value.
  */
 template <typename T> T DataValue::getInt() const
 {
-	T value;
+	T value = 0;
 	std::size_t bytesToCopy = std::min(getSize(), sizeof(T));
 
-	memcpy(&value, _value.data(), bytesToCopy);
+	memcpy(&value, getData(), bytesToCopy);
 	return value;
 }
 
@@ -102,87 +123,262 @@ template std::uint64_t DataValue::getInt<std::uint64_t>() const;
  */
 std::string DataValue::getString() const
 {
-	std::string str = "";
+	const std::uint8_t* data = getData();
 	std::size_t pos = 0;
 
 	// We read until we hit null terminator or we hit the end of the buffer
-	while ((_value[pos] != '\0') && (pos < getSize()))
-	{
-		str += _value[pos];
+	while ((pos < getSize()) && (data[pos] != '\0'))
 		pos++;
-	}
 
-	return str;
+	return std::string(reinterpret_cast<const char*>(data), pos);
 }
 
 /**
- * Returns the value as raw bytes.
+ * Returns the copy of the value as raw bytes.
  *
  * @return Raw bytes.
  */
-const std::vector<std::uint8_t>& DataValue::getBytes() const
+std::vector<std::uint8_t> DataValue::getBytes() const
 {
-	return _value;
+	return std::vector<std::uint8_t>(getData(), getData() + getSize());
 }
 
-DataBuffer::DataBuffer() : _data()
+/**
+ * Stores the bytes of the value, inline if they fit.
+ *
+ * @param data The bytes.
+ * @param size The number of bytes.
+ */
+void DataValue::assign(const std::uint8_t* data, std::size_t size)
 {
+	_size = size;
+	if (size <= INLINE_SIZE)
+	{
+		if (size > 0)
+			memcpy(_inline, data, size);
+		_value.clear();
+	}
+	else
+		_value.assign(data, data + size);
 }
 
-DataBuffer::DataBuffer(std::size_t size) : _data(size, 0)
+DataView::DataView() : _data(nullptr), _size(0)
 {
 }
 
-DataBuffer::DataBuffer(const std::vector<std::uint8_t> &data) : _data(data)
+DataView::DataView(const std::uint8_t* data, std::size_t size) : _data(data), _size(size)
 {
 }
 
-DataBuffer::DataBuffer(const DataBuffer &dataBuffer) : _data(dataBuffer._data)
+DataView::DataView(const DataBuffer& dataBuffer) : _data(dataBuffer.getBuffer().data()), _size(dataBuffer.getSize())
 {
 }
 
-DataBuffer::DataBuffer(const DataBuffer &dataBuffer, std::size_t offset, std::size_t count)
+/**
+ * Returns the size of the view.
+ *
+ * @return The size of the view in bytes.
+ */
+std::size_t DataView::getSize() const
 {
-	count = offset + count >= dataBuffer.getSize() ? dataBuffer.getSize() - offset : count;
-	_data.reserve(count);
-	std::copy(dataBuffer._data.begin() + offset, dataBuffer._data.begin() + offset + count, std::back_inserter(_data));
+	return _size;
 }
 
-DataBuffer::DataBuffer(DataBuffer &&dataBuffer) : _data(std::move(dataBuffer._data))
+/**
+ * Returns the pointer to the first byte of the view.
+ *
+ * @return Pointer to the viewed bytes.
+ */
+const std::uint8_t* DataView::getData() const
 {
+	return _data;
 }
 
-DataBuffer::~DataBuffer()
+/**
+ * Creates the view of the part of this view from the given offset up to given number of bytes.
+ * Nothing is copied.
+ *
+ * @param offset The offset where the sub-view starts.
+ * @param amount The number of bytes in sub-view.
+ *
+ * @return Sub-view.
+ */
+DataView DataView::getSubView(std::size_t offset, std::size_t amount) const
 {
+	if (offset >= getSize())
+		return DataView();
+
+	amount = offset + amount >= getSize() ? getSize() - offset : amount;
+	return DataView(_data + offset, amount);
 }
 
-DataBuffer& DataBuffer::operator =(DataBuffer &&dataBuffer)
+/**
+ * Reads the value in the buffer from the specified offset and specified size.
+ *
+ * @param offset The offset where to read from.
+ * @param amount The number of bytes to read.
+ *
+ * @return DataValue representing the read value.
+ */
+DataValue DataView::read(std::size_t offset, std::size_t amount) const
 {
-	_data = std::move(dataBuffer._data);
-	return *this;
+	// Check of boundaries
+	if (offset >= getSize())
+		return DataValue();
+
+	// Calculate amount of bytes to copy in case we can run out of buffer boundaries
+	std::size_t bytesToCopy = offset + amount >= getSize() ? getSize() - offset : amount;
+	return DataValue(_data + offset, bytesToCopy);
+}
+
+/**
+ * Reads the specific bits from the byte at the specified offset. Method also
+ * access neighbour elements if bitCount overlaps current byte. No more than
+ * 64 bits are read.
+ *
+ * @param byteOffset The offset of the byte.
+ * @param bitOffset The bit from which to start reading. 0 is LSB.
+ * @param bitCount The number of bits to read.
+ *
+ * @return DataValue representing the read value.
+ */
+DataValue DataView::readBits(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const
+{
+	if (byteOffset >= getSize())
+		return DataValue();
+
+	if (bitOffset >= 8)
+		return DataValue();
+
+	return DataValue(bits<std::uint64_t>(byteOffset, bitOffset, bitCount));
 }
 
 /**
- * Creates new DataBuffer with the contents of the whole file.
+ * Reads the specific bits from the bit at the specified offset. Method also
+ * access neighbour elements if bitCount overlaps current byte. No more than
+ * 64 bits are read.
  *
- * @param file The file to read from.
+ * @param bitOffset The bit from which to start reading. 0 is LSB of whole buffer.
+ * @param bitCount The number of bits to read.
  *
- * @return DataBuffer with contents of the file.
+ * @return DataValue representing the read value.
  */
-std::unique_ptr<DataBuffer> DataBuffer::createFromFile(FILE *file)
+DataValue DataView::readBits(std::size_t bitOffset, std::size_t bitCount) const
 {
-	if (file == nullptr)
-		return nullptr;
+	// Dividing by 8 to get index of the byte
+	std::size_t byteOffset = bitOffset >> 3;
+
+	// Modulo 8 to get bit in byte offset
+	std::uint8_t bitInByteOffset = bitOffset & 7;
+
+	return readBits(byteOffset, bitInByteOffset, bitCount);
+}
+
+/**
+ * Reads little-endian integer at the specified offset without any allocation.
+ * Bytes after the end of the view are read as zero.
+ *
+ * @param offset The offset where to read from.
+ *
+ * @return The integer value.
+ */
+template <typename T> T DataView::read(std::size_t offset) const
+{
+	std::uint64_t value = 0;
+	if (offset < getSize())
+	{
+		std::size_t count = std::min(sizeof(T), getSize() - offset);
+		for (std::size_t i = 0; i < count; ++i)
+			value |= static_cast<std::uint64_t>(_data[offset + i]) << (i * 8);
+	}
+
+	return static_cast<T>(value);
+}
+
+template std::int8_t   DataView::read<std::int8_t>(std::size_t offset) const;
+template std::int16_t  DataView::read<std::int16_t>(std::size_t offset) const;
+template std::int32_t  DataView::read<std::int32_t>(std::size_t offset) const;
+template std::int64_t  DataView::read<std::int64_t>(std::size_t offset) const;
+template std::uint8_t  DataView::read<std::uint8_t>(std::size_t offset) const;
+template std::uint16_t DataView::read<std::uint16_t>(std::size_t offset) const;
+template std::uint32_t DataView::read<std::uint32_t>(std::size_t offset) const;
+template std::uint64_t DataView::read<std::uint64_t>(std::size_t offset) const;
+
+/**
+ * Reads the specific bits from the byte at the specified offset without any allocation.
+ * Bits may continue in following bytes, bits after the end of the view are read
+ * as zero. No more than 64 bits are read.
+ *
+ * @param byteOffset The offset of the byte.
+ * @param bitOffset The bit from which to start reading. 0 is LSB.
+ * @param bitCount The number of bits to read.
+ *
+ * @return The bits as integer value.
+ */
+template <typename T> T DataView::bits(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const
+{
+	if (byteOffset >= getSize() || bitOffset >= 8)
+		return static_cast<T>(0);
+
+	bitCount = std::min<std::size_t>(bitCount, 64);
+
+	// Up to 9 bytes cover 64 bits which do not start at byte boundary
+	std::size_t byteCount = std::min<std::size_t>((bitOffset + bitCount + 7) / 8, getSize() - byteOffset);
+	std::uint64_t value = byteCount > 0 ? _data[byteOffset] >> bitOffset : 0;
+	for (std::size_t i = 1; i < byteCount; ++i)
+		value |= static_cast<std::uint64_t>(_data[byteOffset + i]) << (i * 8 - bitOffset);
+
+	if (bitCount < 64)
+		value &= (static_cast<std::uint64_t>(1) << bitCount) - 1;
+
+	return static_cast<T>(value);
+}
 
-	std::size_t size;
-	if (!fileSize(file, size))
-		return nullptr;
+template bool          DataView::bits<bool>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+template std::uint8_t  DataView::bits<std::uint8_t>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+template std::uint16_t DataView::bits<std::uint16_t>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+template std::uint32_t DataView::bits<std::uint32_t>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+template std::uint64_t DataView::bits<std::uint64_t>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
 
-	std::vector<std::uint8_t> contents;
-	if (!readFile(file, 0, size, contents))
-		return nullptr;
+DataBuffer::DataBuffer() : _data()
+{
+}
+
+DataBuffer::DataBuffer(std::size_t size, Arena* arena) : _data(size, 0, ArenaAllocator<std::uint8_t>(arena))
+{
+}
 
-	return std::make_unique<DataBuffer>(contents);
+DataBuffer::DataBuffer(const std::vector<std::uint8_t> &data) : _data(data.begin(), data.end())
+{
+}
+
+DataBuffer::DataBuffer(ArenaVector<std::uint8_t> &&data) : _data(std::move(data))
+{
+}
+
+DataBuffer::DataBuffer(const DataBuffer &dataBuffer) : _data(dataBuffer._data)
+{
+}
+
+DataBuffer::DataBuffer(const DataBuffer &dataBuffer, std::size_t offset, std::size_t count) : _data(dataBuffer._data.get_allocator())
+{
+	count = offset + count >= dataBuffer.getSize() ? dataBuffer.getSize() - offset : count;
+	_data.reserve(count);
+	std::copy(dataBuffer._data.begin() + offset, dataBuffer._data.begin() + offset + count, std::back_inserter(_data));
+}
+
+DataBuffer::DataBuffer(DataBuffer &&dataBuffer) : _data(std::move(dataBuffer._data))
+{
+}
+
+DataBuffer::~DataBuffer()
+{
+}
+
+DataBuffer& DataBuffer::operator =(DataBuffer &&dataBuffer)
+{
+	_data = std::move(dataBuffer._data);
+	return *this;
 }
 
 bool DataBuffer::writeToFile(FILE* file)
@@ -206,11 +402,53 @@ std::size_t DataBuffer::getSize() const
 	return _data.size();
 }
 
-const std::vector<std::uint8_t>& DataBuffer::getBuffer() const
+const ArenaVector<std::uint8_t>& DataBuffer::getBuffer() const
 {
 	return _data;
 }
 
+/**
+ * Returns the pointer to the raw bytes of the buffer which can be used for writing.
+ * The pointer is invalidated by any operation which changes the size of the buffer.
+ *
+ * @return Pointer to the first byte of the buffer.
+ */
+std::uint8_t* DataBuffer::getRawData()
+{
+	return _data.data();
+}
+
+/**
+ * Resizes the buffer. Newly added bytes are set to 0.
+ *
+ * @param size The new size of the buffer in bytes.
+ */
+void DataBuffer::resize(std::size_t size)
+{
+	_data.resize(size);
+}
+
+/**
+ * Reserves the memory, so the buffer does not reallocate until it grows over the given size.
+ *
+ * @param size The number of bytes to reserve.
+ */
+void DataBuffer::reserve(std::size_t size)
+{
+	_data.reserve(size);
+}
+
+/**
+ * Removes the bytes from the buffer. Following bytes are moved in place, the memory is kept.
+ *
+ * @param offset The offset of the first byte to remove.
+ * @param amount The number of bytes to remove.
+ */
+void DataBuffer::erase(std::size_t offset, std::size_t amount)
+{
+	_data.erase(_data.begin() + offset, _data.begin() + offset + amount);
+}
+
 /**
  * Creates the copy of the sub-buffer from the given offset up to given number of bytes.
  *
@@ -234,24 +472,12 @@ DataBuffer DataBuffer::getSubBuffer(std::size_t offset, std::size_t amount) cons
  */
 DataValue DataBuffer::read(std::size_t offset, std::size_t amount) const
 {
-	// Check of boundaries
-	if (offset >= getSize())
-		return DataValue();
-
-	// Calculate amount of bytes to copy in case we can run out of buffer boundaries
-	std::size_t bytesToCopy = offset + amount >= getSize() ? getSize() - offset : amount;
-	std::vector<std::uint8_t> bytes;
-	bytes.reserve(bytesToCopy);
-
-	// Copy using back inserter
-	std::copy(_data.begin() + offset, _data.begin() + offset + bytesToCopy, std::back_inserter(bytes));
-	return DataValue(bytes);
+	return DataView(*this).read(offset, amount);
 }
 
 /**
- * Reads the specific bits from the byte at the specified offset. Method also
- * access neighbour elements if bitCount overlaps current byte. No more than
- * 64 bits are read.
+ * Reads the specific bits from the byte at the specified offset.
+ * See DataView::readBits().
  *
  * @param byteOffset The offset of the byte.
  * @param bitOffset The bit from which to start reading. 0 is LSB.
@@ -261,54 +487,12 @@ DataValue DataBuffer::read(std::size_t offset, std::size_t amount) const
  */
 DataValue DataBuffer::readBits(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const
 {
-	if (byteOffset >= getSize())
-		return DataValue();
-
-	if (bitOffset >= 8)
-		return DataValue();
-
-	// We don't read more than 64 bits
-	if (bitCount >= (sizeof(std::uint64_t) * 8))
-		bitCount = 64;
-
-	std::uint8_t currentByte = _data[byteOffset] >> bitOffset;
-	std::size_t bitsWritten = 0;
-	std::uint64_t val = 0;
-	while (bitCount > 0)
-	{
-		// We take the current byte and mask it out so only required number of bits is taken into account
-		// We then shift it right so it fits right position based on the amount of bits already read
-		val |= static_cast<std::uint64_t>((currentByte & _getBitMask(bitCount))) << bitsWritten;
-
-		// We now need to calculate how many bits we have written
-		// If there is less than 8 bits left, use that count as number of bits we have written
-		// Otherwise, calculate it with formula 8 - bitOffset
-		if (bitOffset + bitCount < 8)
-		{
-			bitsWritten += bitCount;
-			bitCount -= bitCount;
-		}
-		else
-		{
-			bitsWritten += 8 - bitOffset;
-			bitCount -= 8 - bitOffset;
-		}
-
-		byteOffset++;
-		if (byteOffset >= getSize())
-			break;
-
-		currentByte = _data[byteOffset];
-		bitOffset = 0; // We must set bitOffset to 0 because we will be reading from this offset in all consecutive iterations 
-	}
-
-	return DataValue(val);
+	return DataView(*this).readBits(byteOffset, bitOffset, bitCount);
 }
 
 /**
- * Reads the specific bits from the bit at the specified offset. Method also
- * access neighbour elements if bitCount overlaps current byte. No more than
- * 64 bits are read.
+ * Reads the specific bits from the bit at the specified offset.
+ * See DataView::readBits().
  *
  * @param bitOffset The bit from which to start reading. 0 is LSB of whole buffer.
  * @param bitCount The number of bits to read.
@@ -317,47 +501,50 @@ DataValue DataBuffer::readBits(std::size_t byteOffset, std::uint8_t bitOffset, s
  */
 DataValue DataBuffer::readBits(std::size_t bitOffset, std::size_t bitCount) const
 {
-	// Dividing by 8 to get index of the byte
-	std::size_t byteOffset = bitOffset >> 3;
-
-	// Modulo 8 to get bit in byte offset
-	std::uint8_t bitInByteOffset = bitOffset & 7;
-
-	return readBits(byteOffset, bitInByteOffset, bitCount);
+	return DataView(*this).readBits(bitOffset, bitCount);
 }
 
-std::uint8_t DataBuffer::_getBitMask(std::size_t bitCount)
+/**
+ * Reads little-endian integer at the specified offset. See DataView::read().
+ *
+ * @param offset The offset where to read from.
+ *
+ * @return The integer value.
+ */
+template <typename T> T DataBuffer::read(std::size_t offset) const
 {
-	// We don't use breaks in switch intentionally
-	// We first set mask to highest possible (0xFF) and then abuse fall through switch
-	// and set bits 0.
-	// The order of cases is very important!!! Do not change!!!
-	std::uint8_t mask = 0xFF;
-	switch (bitCount)
-	{
-		case 0:
-			mask &= ~0x01;
-		case 1:
-			mask &= ~0x02;
-		case 2:
-			mask &= ~0x04;
-		case 3:
-			mask &= ~0x08;
-		case 4:
-			mask &= ~0x10;
-		case 5:
-			mask &= ~0x20;
-		case 6:
-			mask &= ~0x40;
-		case 7:
-			mask &= ~0x80;
-		default:
-			break;
-	}
+	return DataView(*this).read<T>(offset);
+}
+
+template std::int8_t   DataBuffer::read<std::int8_t>(std::size_t offset) const;
+template std::int16_t  DataBuffer::read<std::int16_t>(std::size_t offset) const;
+template std::int32_t  DataBuffer::read<std::int32_t>(std::size_t offset) const;
+template std::int64_t  DataBuffer::read<std::int64_t>(std::size_t offset) const;
+template std::uint8_t  DataBuffer::read<std::uint8_t>(std::size_t offset) const;
+template std::uint16_t DataBuffer::read<std::uint16_t>(std::size_t offset) const;
+template std::uint32_t DataBuffer::read<std::uint32_t>(std::size_t offset) const;
+template std::uint64_t DataBuffer::read<std::uint64_t>(std::size_t offset) const;
 
-	return mask;
+/**
+ * Reads the specific bits from the byte at the specified offset. See DataView::bits().
+ *
+ * @param byteOffset The offset of the byte.
+ * @param bitOffset The bit from which to start reading. 0 is LSB.
+ * @param bitCount The number of bits to read.
+ *
+ * @return The bits as integer value.
+ */
+template <typename T> T DataBuffer::bits(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const
+{
+	return DataView(*this).bits<T>(byteOffset, bitOffset, bitCount);
 }
 
+template bool          DataBuffer::bits<bool>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+template std::uint8_t  DataBuffer::bits<std::uint8_t>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+template std::uint16_t DataBuffer::bits<std::uint16_t>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+template std::uint32_t DataBuffer::bits<std::uint32_t>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+template std::uint64_t DataBuffer::bits<std::uint64_t>(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+
 void DataBuffer::write(std::size_t offset, const std::vector<std::uint8_t>& data)
 {
 	if (offset + data.size() - 1 >= getSize())
@@ -376,7 +563,13 @@ void DataBuffer::write(std::size_t offset, std::uint8_t byte)
 
 void DataBuffer::write(std::size_t offset, const DataValue& value)
 {
-	write(offset, value.getBytes());
+	if (value.getSize() == 0)
+		return;
+
+	if (offset + value.getSize() > getSize())
+		_data.resize(offset + value.getSize());
+
+	std::copy(value.getData(), value.getData() + value.getSize(), _data.begin() + offset);
 }
 
 /**
@@ -386,7 +579,17 @@ void DataBuffer::write(std::size_t offset, const DataValue& value)
  */
 void DataBuffer::append(const DataBuffer& data)
 {
-	append(data._data);
+	append(DataView(data));
+}
+
+/**
+ * Appends viewed bytes to this DataBuffer.
+ *
+ * @param data DataView to append.
+ */
+void DataBuffer::append(const DataView& data)
+{
+	_data.insert(_data.end(), data.getData(), data.getData() + data.getSize());
 }
 
 /**
@@ -416,5 +619,5 @@ void DataBuffer::append(std::uint8_t byte)
  */
 void DataBuffer::append(const DataValue& value)
 {
-	append(value.getBytes());
+	_data.insert(_data.end(), value.getData(), value.getData() + value.getSize());
 }
@@ -2,20 +2,23 @@
 #define DATA_BUFFER_H
 
 #include <cstdint>
-#include <memory>
 #include <string>
 #include <vector>
 
+#include "arena.h"
+
 /**
  * This class stores single multi-byte value from DataBuffer. The data are stored
  * as raw bytes but they can be accessed as integral or string types using
- * interface of this class.
+ * interface of this class. Values of up to 8 bytes are stored inline
+ * without any allocation.
  */
 class DataValue
 {
 public:
 	DataValue();
 	template <typename T> DataValue(T value);
+	DataValue(const std::uint8_t* data, std::size_t size);
 	DataValue(const std::string &value);
 	DataValue(const std::vector<std::uint8_t> &value);
 	DataValue(const DataValue &dataValue);
@@ -25,26 +28,66 @@ public:
 	DataValue& operator =(DataValue &&dataValue);
 
 	std::size_t getSize() const;
+	const std::uint8_t* getData() const;
 
 	bool getBool() const;
 	template <typename T> T getInt() const;
 	std::string getString() const;
-	const std::vector<std::uint8_t>& getBytes() const;
+	std::vector<std::uint8_t> getBytes() const;
 
 private:
+	static const std::size_t INLINE_SIZE = 8;
+
+	void assign(const std::uint8_t* data, std::size_t size);
+
+	std::uint8_t _inline[INLINE_SIZE];
 	std::vector<std::uint8_t> _value;
+	std::size_t _size;
+};
+
+class DataBuffer;
+
+/**
+ * This class represents non-owning view of the bytes stored somewhere else and
+ * provides the same interface to read the data as DataBuffer. Sub-views
+ * are just pointers into the same memory, nothing is copied. The view is valid
+ * only as long as the viewed memory.
+ */
+class DataView
+{
+public:
+	DataView();
+	DataView(const std::uint8_t* data, std::size_t size);
+	DataView(const DataBuffer& dataBuffer);
+
+	std::size_t getSize() const;
+	const std::uint8_t* getData() const;
+	DataView getSubView(std::size_t offset, std::size_t amount) const;
+
+	DataValue read(std::size_t offset, std::size_t amount) const;
+	DataValue readBits(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+	DataValue readBits(std::size_t bitOffset, std::size_t bitCount) const;
+
+	template <typename T> T read(std::size_t offset) const;
+	template <typename T> T bits(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+
+private:
+	const std::uint8_t* _data;
+	std::size_t _size;
 };
 
 /**
  * This class represent the buffer of bytes and provides interface
- * to read the data from it.
+ * to read the data from it. The bytes are taken from the arena
+ * if it is given, otherwise from the heap.
  */
 class DataBuffer
 {
 public:
 	DataBuffer();
-	DataBuffer(std::size_t size);
+	DataBuffer(std::size_t size, Arena* arena = nullptr);
 	DataBuffer(const std::vector<std::uint8_t> &data);
+	DataBuffer(ArenaVector<std::uint8_t> &&data);
 	DataBuffer(const DataBuffer &dataBuffer);
 	DataBuffer(const DataBuffer &dataBuffer, std::size_t offset, std::size_t count);
 	DataBuffer(DataBuffer &&dataBuffer);
@@ -52,30 +95,35 @@ public:
 
 	DataBuffer& operator =(DataBuffer &&dataBuffer);
 
-	static std::unique_ptr<DataBuffer> createFromFile(FILE *file);
 	bool writeToFile(FILE* file);
 
 	std::size_t getSize() const;
-	const std::vector<std::uint8_t>& getBuffer() const;
+	const ArenaVector<std::uint8_t>& getBuffer() const;
+	std::uint8_t* getRawData();
+	void resize(std::size_t size);
+	void reserve(std::size_t size);
+	void erase(std::size_t offset, std::size_t amount);
 	DataBuffer getSubBuffer(std::size_t offset, std::size_t amount) const;
 
 	DataValue read(std::size_t offset, std::size_t amount) const;
 	DataValue readBits(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
 	DataValue readBits(std::size_t bitOffset, std::size_t bitCount) const;
 
+	template <typename T> T read(std::size_t offset) const;
+	template <typename T> T bits(std::size_t byteOffset, std::uint8_t bitOffset, std::size_t bitCount) const;
+
 	void write(std::size_t offset, const std::vector<std::uint8_t>& data);
 	void write(std::size_t offset, std::uint8_t byte);
 	void write(std::size_t offset, const DataValue& value);
 
 	void append(const DataBuffer &data);
+	void append(const DataView &data);
 	void append(const std::vector<std::uint8_t> &data);
 	void append(std::uint8_t byte);
 	void append(const DataValue& value);
 
 private:
-	static std::uint8_t _getBitMask(std::size_t bitCount);
-
-	std::vector<std::uint8_t> _data;
+	ArenaVector<std::uint8_t> _data;
 };
 
 #endif
@@ -1,17 +1,408 @@
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "arena.h"
+#include "bmp_writer.h"
 #include "gif2bmp.h"
 #include "gif_decoder.h"
+#include "image_scaler.h"
+#include "output_buffer.h"
 
-int gif2bmp(tGIF2BMP * /*gif2bmp*/, FILE *inputFile, FILE *outputFile)
+struct tGIF2BMPARENA
 {
-	GifDecoder gifDecoder(inputFile);
+	tGIF2BMPARENA(std::size_t blockSize) : arena(blockSize) {}
+
+	Arena arena;
+};
+
+struct tGIF2BMPCONTEXT
+{
+	tGIF2BMPCONTEXT() : arena(), decoder() {}
+
+	Arena arena;
+	GifDecoder decoder;
+};
+
+static const tGIF2BMPOPTIONS& optionsOrDefault(const tGIF2BMPOPTIONS *options)
+{
+	static const tGIF2BMPOPTIONS defaultOptions = []() {
+			tGIF2BMPOPTIONS result;
+			gif2bmpDefaultOptions(&result);
+			return result;
+		}();
+
+	return options ? *options : defaultOptions;
+}
+
+static BmpFormat bmpFormat(const tGIF2BMPOPTIONS& options)
+{
+	if (options.bitsPerPixel != 8)
+		return BMP_FORMAT_24BIT;
+
+	return options.rle ? BMP_FORMAT_RLE8 : BMP_FORMAT_8BIT;
+}
+
+static bool thumbnail(const tGIF2BMPOPTIONS& options)
+{
+	return options.thumbnailWidth > 0 || options.thumbnailHeight > 0;
+}
+
+/**
+ * Saves the image as BMP, downscaled first if the thumbnail is requested.
+ */
+static bool saveImage(const Image& image, BmpWriter& bmpWriter, const tGIF2BMPOPTIONS& options)
+{
+	if (!thumbnail(options))
+		return image.saveBmp(bmpWriter, bmpFormat(options));
+
+	std::uint16_t width, height;
+	ImageScaler::fitSize(image.getWidth(), image.getHeight(), options.thumbnailWidth, options.thumbnailHeight, width, height);
+	return image.scale(width, height)->saveBmp(bmpWriter, bmpFormat(options));
+}
+
+/**
+ * Receives rows of the streamed canvas. Rows are written right into top-down BMP
+ * or accumulated into the thumbnail. Decoder gets only the reference to the writer
+ * as its callback, which does not need any allocation.
+ */
+class CanvasRowWriter
+{
+public:
+	CanvasRowWriter(const GifDecoder& gifDecoder, BmpWriter& bmpWriter, const tGIF2BMPOPTIONS& options, Arena& arena) :
+		_gifDecoder(gifDecoder), _options(options), _arena(arena), _bmpWriter(bmpWriter), _scaler(), _streamed(false), _written(true)
+	{
+	}
+
+	void writeRow(std::uint16_t row, const ArenaVector<Color>& colors)
+	{
+		if (thumbnail(_options))
+		{
+			if (row == 0)
+			{
+				std::uint16_t width, height;
+				ImageScaler::fitSize(_gifDecoder.getCanvasWidth(), _gifDecoder.getCanvasHeight(), _options.thumbnailWidth, _options.thumbnailHeight, width, height);
+				_scaler = std::make_unique<ImageScaler>(_gifDecoder.getCanvasWidth(), _gifDecoder.getCanvasHeight(), width, height, &_arena);
+			}
+
+			_scaler->addRow(colors.data());
+			return;
+		}
+
+		if (row == 0)
+		{
+			std::uint16_t width = static_cast<std::uint16_t>(colors.size());
+			std::uint16_t height = _gifDecoder.getCanvasHeight();
+			std::uint64_t dataSize = static_cast<std::uint64_t>(BmpWriter::paddedRowSize(width, 3)) * height;
+			_written = _bmpWriter.writeHeader(width, -static_cast<std::int32_t>(height), 24, BMP_COMPRESSION_NONE, nullptr, dataSize);
+			_streamed = true;
+		}
+
+		_written = _written && _bmpWriter.writeRow(colors);
+	}
+
+	bool isStreamed() const
+	{
+		return _streamed;
+	}
+
+	bool isWritten() const
+	{
+		return _written;
+	}
+
+	ImageScaler* getScaler() const
+	{
+		return _scaler.get();
+	}
+
+private:
+	const GifDecoder& _gifDecoder;
+	const tGIF2BMPOPTIONS& _options;
+	Arena& _arena;
+	BmpWriter& _bmpWriter;
+	std::unique_ptr<ImageScaler> _scaler;
+	bool _streamed;
+	bool _written;
+};
+
+/**
+ * Returns the arena for transient buffers of single call. The arena given in options
+ * or the one of the context is reset, so its memory from the previous call is reused.
+ */
+static Arena& callArena(const tGIF2BMPOPTIONS& options, Arena& ownArena)
+{
+	Arena* arena = options.arena ? &options.arena->arena : (options.context ? &options.context->arena : nullptr);
+	if (arena == nullptr)
+		return ownArena;
+
+	arena->reset();
+	return *arena;
+}
+
+/**
+ * Returns the decoder for single call, the one of the context if it is given.
+ */
+static GifDecoder& callDecoder(const tGIF2BMPOPTIONS& options, GifDecoder& ownDecoder)
+{
+	return options.context ? options.context->decoder : ownDecoder;
+}
+
+static void applyOptions(GifDecoder& gifDecoder, const tGIF2BMPOPTIONS& options, Arena& arena)
+{
+	// Decoder of the context still has callbacks and settings of the previous call
+	gifDecoder.setStreaming(false);
+	gifDecoder.setRowCallback(nullptr);
+	gifDecoder.setImageCallback(nullptr);
+	gifDecoder.setPassCallback(nullptr);
+	gifDecoder.setCanvasRowCallback(nullptr);
+	gifDecoder.setThreadCount(options.threadCount);
+	gifDecoder.setArena(&arena);
+
+	GifDecoder::ImageDescriptor region;
+	region.x = options.regionX;
+	region.y = options.regionY;
+	region.width = options.regionWidth;
+	region.height = options.regionHeight;
+	gifDecoder.setRegion(region);
+
+	GifDecoder::Limits limits;
+	limits.maxPixels = options.maxPixels;
+	limits.maxFrames = options.maxFrames;
+	limits.maxDecodedPixels = options.maxDecodedPixels;
+	limits.maxTime = options.maxTime;
+	limits.maxExpansionRatio = options.maxExpansionRatio;
+	gifDecoder.setLimits(limits);
+}
+
+/**
+ * Decodes the input which is set to the decoder and writes the whole image as BMP.
+ * Conversions of the file and of the memory differ only by the input of the decoder
+ * and by the output of the writer.
+ */
+static int convert(GifDecoder& gifDecoder, BmpWriter& bmpWriter, const tGIF2BMPOPTIONS& gifOptions, Arena& arena)
+{
+	// Streamed rows come from top to bottom, so they are written into top-down BMP with negative height
+	// Thumbnail is always streamed if possible, rows are then only accumulated into the small image
+	gifDecoder.setStreaming(thumbnail(gifOptions) || (gifOptions.streaming && bmpFormat(gifOptions) == BMP_FORMAT_24BIT));
+	CanvasRowWriter rowWriter(gifDecoder, bmpWriter, gifOptions, arena);
+	gifDecoder.setCanvasRowCallback([&rowWriter](std::uint16_t row, const ArenaVector<Color>& colors) {
+			rowWriter.writeRow(row, colors);
+		});
+
 	if (!gifDecoder.decode())
-		return -1;
+		return gifDecoder.isLimitExceeded() ? GIF2BMP_LIMIT_EXCEEDED : -1;
+
+	if (rowWriter.isStreamed())
+		return rowWriter.isWritten() ? 0 : -1;
+
+	if (rowWriter.getScaler() != nullptr)
+		return rowWriter.getScaler()->createImage()->saveBmp(bmpWriter, bmpFormat(gifOptions)) ? 0 : -1;
 
 	if (gifDecoder.getImage() == nullptr)
 		return -1;
 
-	if (!gifDecoder.getImage()->saveBmp(outputFile))
+	if (!saveImage(*gifDecoder.getImage(), bmpWriter, gifOptions))
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Converts GIF in memory into the output buffer. Input is decoded right from
+ * the memory of the caller, nothing is copied or read.
+ */
+static int convertMemory(const uint8_t *input, size_t inputSize, OutputBuffer& outputBuffer, const tGIF2BMPOPTIONS *options)
+{
+	if (input == nullptr)
+		return -1;
+
+	const tGIF2BMPOPTIONS& gifOptions = optionsOrDefault(options);
+
+	Arena ownArena;
+	Arena& arena = callArena(gifOptions, ownArena);
+	GifDecoder ownDecoder;
+	GifDecoder& gifDecoder = callDecoder(gifOptions, ownDecoder);
+	applyOptions(gifDecoder, gifOptions, arena);
+	gifDecoder.setData(DataView(input, inputSize));
+
+	BmpWriter bmpWriter(&outputBuffer, &arena);
+	return convert(gifDecoder, bmpWriter, gifOptions, arena);
+}
+
+void gif2bmpDefaultOptions(tGIF2BMPOPTIONS *options)
+{
+	if (options == nullptr)
+		return;
+
+	options->threadCount = 1;
+	options->bitsPerPixel = 24;
+	options->rle = 0;
+	options->streaming = 0;
+	options->regionX = options->regionY = 0;
+	options->regionWidth = options->regionHeight = 0;
+	options->thumbnailWidth = options->thumbnailHeight = 0;
+	options->maxPixels = 0;
+	options->maxFrames = 0;
+	options->maxDecodedPixels = 0;
+	options->maxTime = 0;
+	options->maxExpansionRatio = 0;
+	options->arena = nullptr;
+	options->context = nullptr;
+}
+
+tGIF2BMPARENA *gif2bmpArenaCreate(size_t blockSize)
+{
+	return new tGIF2BMPARENA(blockSize == 0 ? ARENA_BLOCK_SIZE : blockSize);
+}
+
+void gif2bmpArenaDestroy(tGIF2BMPARENA *arena)
+{
+	delete arena;
+}
+
+size_t gif2bmpArenaCapacity(const tGIF2BMPARENA *arena)
+{
+	if (arena == nullptr)
+		return 0;
+
+	return arena->arena.getCapacity();
+}
+
+tGIF2BMPCONTEXT *gif2bmpContextCreate(void)
+{
+	return new tGIF2BMPCONTEXT();
+}
+
+void gif2bmpContextDestroy(tGIF2BMPCONTEXT *context)
+{
+	delete context;
+}
+
+int gif2bmp(tGIF2BMP *gif2bmp, FILE *inputFile, FILE *outputFile)
+{
+	return gif2bmpEx(gif2bmp, inputFile, outputFile, nullptr);
+}
+
+int gif2bmpEx(tGIF2BMP * /*gif2bmp*/, FILE *inputFile, FILE *outputFile, const tGIF2BMPOPTIONS *options)
+{
+	const tGIF2BMPOPTIONS& gifOptions = optionsOrDefault(options);
+
+	// All transient buffers of the conversion come from the arena, which has to outlive the decoder
+	Arena ownArena;
+	Arena& arena = callArena(gifOptions, ownArena);
+	GifDecoder ownDecoder;
+	GifDecoder& gifDecoder = callDecoder(gifOptions, ownDecoder);
+	applyOptions(gifDecoder, gifOptions, arena);
+	gifDecoder.setFile(inputFile);
+
+	BmpWriter bmpWriter(outputFile, &arena);
+	return convert(gifDecoder, bmpWriter, gifOptions, arena);
+}
+
+int gif2bmpMemory(tGIF2BMP * /*gif2bmp*/, const uint8_t *input, size_t inputSize, uint8_t *output, size_t *outputSize, const tGIF2BMPOPTIONS *options)
+{
+	if (outputSize == nullptr)
+		return -1;
+
+	OutputBuffer outputBuffer(output, *outputSize);
+	int result = convertMemory(input, inputSize, outputBuffer, options);
+	if (result != 0)
+		return result;
+
+	*outputSize = outputBuffer.getSize();
+	return outputBuffer.isTruncated() ? GIF2BMP_BUFFER_TOO_SMALL : 0;
+}
+
+int gif2bmpMemoryAlloc(tGIF2BMP * /*gif2bmp*/, const uint8_t *input, size_t inputSize, uint8_t **output, size_t *outputSize, const tGIF2BMPOPTIONS *options)
+{
+	if (output == nullptr || outputSize == nullptr)
+		return -1;
+
+	*output = nullptr;
+	*outputSize = 0;
+
+	OutputBuffer outputBuffer;
+	int result = convertMemory(input, inputSize, outputBuffer, options);
+	if (result != 0)
+		return result;
+
+	*outputSize = outputBuffer.getSize();
+	*output = outputBuffer.release();
+	return 0;
+}
+
+void gif2bmpFree(uint8_t *output)
+{
+	std::free(output);
+}
+
+int gif2bmpFrames(tGIF2BMP * /*gif2bmp*/, FILE *inputFile, const char *outputPrefix, const tGIF2BMPOPTIONS *options)
+{
+	if (outputPrefix == nullptr)
 		return -1;
 
+	const tGIF2BMPOPTIONS& gifOptions = optionsOrDefault(options);
+
+	// Every composited frame is written as <prefix><frame number>.bmp as soon as it is decoded
+	std::uint32_t frameCount = 0;
+	bool saved = true;
+	Arena ownArena;
+	Arena& arena = callArena(gifOptions, ownArena);
+	GifDecoder ownDecoder;
+	GifDecoder& gifDecoder = callDecoder(gifOptions, ownDecoder);
+	applyOptions(gifDecoder, gifOptions, arena);
+	gifDecoder.setFile(inputFile);
+	gifDecoder.setImageCallback([&](const Image& image) {
+			std::string fileName = outputPrefix + numberToString(frameCount++, 4) + ".bmp";
+			FILE *outputFile = fopen(fileName.c_str(), "wb");
+			if (outputFile == nullptr)
+			{
+				saved = false;
+				return;
+			}
+
+			BmpWriter bmpWriter(outputFile, &arena);
+			saved = saveImage(image, bmpWriter, gifOptions) && saved;
+			fclose(outputFile);
+		});
+
+	if (!gifDecoder.decode())
+		return gifDecoder.isLimitExceeded() ? GIF2BMP_LIMIT_EXCEEDED : -1;
+
+	if (frameCount == 0 || !saved)
+		return -1;
+
+	return 0;
+}
+
+int gifProbe(tGIFINFO *gifInfo, FILE *inputFile)
+{
+	if (gifInfo == nullptr)
+		return -1;
+
+	GifDecoder gifDecoder(inputFile);
+	if (!gifDecoder.probe())
+		return -1;
+
+	const GifDecoder::GifInfo& info = gifDecoder.getInfo();
+	gifInfo->width = info.width;
+	gifInfo->height = info.height;
+	gifInfo->frameCount = info.frames.size();
+	gifInfo->interlacedFrameCount = 0;
+	gifInfo->globalColorTableSize = info.colorTableSize;
+	gifInfo->maxLocalColorTableSize = 0;
+	gifInfo->compressedSize = info.compressedSize;
+	gifInfo->pixelCount = info.pixelCount;
+
+	for (const auto& frame : info.frames)
+	{
+		if (frame.descriptor.interlaced)
+			gifInfo->interlacedFrameCount++;
+
+		if (frame.colorTableSize > gifInfo->maxLocalColorTableSize)
+			gifInfo->maxLocalColorTableSize = frame.colorTableSize;
+	}
+
 	return 0;
 }
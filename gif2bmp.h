@@ -1,8 +1,25 @@
 #ifndef GIF2BMP_H
 #define GIF2BMP_H
 
-#include <cstdint>
-#include <cstdio>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Result of conversion which failed because some of the limits in options was exceeded, other failures are -1
+#define GIF2BMP_LIMIT_EXCEEDED -2
+
+// Result of conversion into the memory of the caller which is too small, the required size is returned instead
+#define GIF2BMP_BUFFER_TOO_SMALL -3
+
+// Memory for transient buffers of conversions which is kept between the calls, see gif2bmpArenaCreate()
+typedef struct tGIF2BMPARENA tGIF2BMPARENA;
+
+// Decoder with its buffers, LZW code table and threads which is reused by conversions, see gif2bmpContextCreate()
+typedef struct tGIF2BMPCONTEXT tGIF2BMPCONTEXT;
 
 typedef struct
 {
@@ -10,6 +27,63 @@ typedef struct
 	int64_t gifSize;
 } tGIF2BMP;
 
+typedef struct
+{
+	uint16_t width;
+	uint16_t height;
+	uint32_t frameCount;
+	uint32_t interlacedFrameCount;
+	uint16_t globalColorTableSize;
+	uint16_t maxLocalColorTableSize;
+	int64_t compressedSize;
+	int64_t pixelCount;
+} tGIFINFO;
+
+typedef struct
+{
+	uint32_t threadCount; // Number of threads decoding frames in parallel, 0 for the number of CPUs
+	uint16_t bitsPerPixel; // Depth of output BMP, 24 or 8, images with more than 256 colors are always written as 24-bit
+	uint8_t rle; // Compresses 8-bit output BMP by RLE8
+	uint8_t streaming; // Writes rows of single-frame non-interlaced GIF into top-down 24-bit BMP as they are decoded, pipe input is read whole first
+	uint16_t regionX; // Region of the image to decode and write, the whole image if its width or height is 0
+	uint16_t regionY;
+	uint16_t regionWidth;
+	uint16_t regionHeight;
+	uint16_t thumbnailWidth; // Downscales the image to fit into this size keeping its aspect ratio, no limit if 0
+	uint16_t thumbnailHeight;
+	uint64_t maxPixels; // Limits for untrusted GIF, 0 for no limit: pixels of the canvas and of every frame
+	uint32_t maxFrames; // Number of frames
+	uint64_t maxDecodedPixels; // Pixels of all frames together
+	uint32_t maxTime; // Milliseconds of decoding
+	uint32_t maxExpansionRatio; // Pixels of the frame per byte of its compressed data
+	tGIF2BMPARENA *arena; // Arena which is reset and reused by the call, single call at a time, own arena of the call if null
+	tGIF2BMPCONTEXT *context; // Decoder and arena reused by the call, single call at a time, the arena above takes precedence
+} tGIF2BMPOPTIONS;
+
+void gif2bmpDefaultOptions(tGIF2BMPOPTIONS *options);
+
+tGIF2BMPARENA *gif2bmpArenaCreate(size_t blockSize);
+void gif2bmpArenaDestroy(tGIF2BMPARENA *arena);
+size_t gif2bmpArenaCapacity(const tGIF2BMPARENA *arena);
+
+tGIF2BMPCONTEXT *gif2bmpContextCreate(void);
+void gif2bmpContextDestroy(tGIF2BMPCONTEXT *context);
+
+// Input file is read by its descriptor, it must not be read by stdio functions before the call
 int gif2bmp(tGIF2BMP *gif2bmp, FILE *inputFile, FILE *outputFile);
+int gif2bmpEx(tGIF2BMP *gif2bmp, FILE *inputFile, FILE *outputFile, const tGIF2BMPOPTIONS *options);
+// Conversions of GIF in memory into BMP in memory without any file, input is decoded right from the memory
+// Output goes into the memory of the caller, outputSize is its capacity on input and the size of BMP on output
+// If the memory is null or too small, GIF2BMP_BUFFER_TOO_SMALL is returned with the required size in outputSize
+int gif2bmpMemory(tGIF2BMP *gif2bmp, const uint8_t *input, size_t inputSize, uint8_t *output, size_t *outputSize, const tGIF2BMPOPTIONS *options);
+// Output goes into the memory allocated by the library, which has to be released by gif2bmpFree()
+int gif2bmpMemoryAlloc(tGIF2BMP *gif2bmp, const uint8_t *input, size_t inputSize, uint8_t **output, size_t *outputSize, const tGIF2BMPOPTIONS *options);
+void gif2bmpFree(uint8_t *output);
+int gif2bmpFrames(tGIF2BMP *gif2bmp, FILE *inputFile, const char *outputPrefix, const tGIF2BMPOPTIONS *options);
+int gifProbe(tGIFINFO *gifInfo, FILE *inputFile);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
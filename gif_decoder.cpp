@@ -1,10 +1,11 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
 #include <vector>
 
 #include "gif_decoder.h"
-#include "lzw_decoder.h"
 
 #ifdef _DEBUG
 static inline void print()
@@ -23,7 +24,110 @@ template <typename... Args> static inline void print(const Args&.../* args*/)
 }
 #endif
 
-GifDecoder::GifDecoder(FILE *gifFile) : _gifFile(gifFile), _gifBuffer(nullptr), _decodePos(0), _colorTableStack(), _image(nullptr)
+// The largest block which is decoded at once is image descriptor with local color table
+// and LZW min. code size, so this is the most what has to be kept between two chunks
+static const std::size_t MAX_BLOCK_SIZE = 1024;
+
+// Size of the chunks in which the input is read when it cannot be mapped
+static const std::size_t INPUT_CHUNK_SIZE = 64 * 1024;
+
+// Frames with at least this many pixels are decoded by multiple threads split at clear codes
+static const std::size_t SEGMENTED_FRAME_MIN_SIZE = 1024 * 1024;
+
+// Number of parts per thread into which the segmented frame is split for better load balancing
+static const std::size_t SEGMENTED_FRAME_PARTS_PER_THREAD = 4;
+
+// Size of the window of rows into which the frame is decoded when its rows are streamed, at least single row is decoded at once
+static const std::size_t STREAM_WINDOW_SIZE = 4 * 1024;
+
+// The first row and the row step of every pass of interlaced image
+static const std::uint16_t INTERLACE_PASS_START[INTERLACE_PASS_COUNT] = { 0, 4, 2, 1 };
+static const std::uint16_t INTERLACE_PASS_STEP[INTERLACE_PASS_COUNT] = { 8, 8, 4, 2 };
+
+/**
+ * Checks the value against the limit.
+ *
+ * @param limit The limit, 0 for no limit.
+ * @param value The value to check.
+ *
+ * @return True if the value exceeds the limit, otherwise false.
+ */
+static bool exceedsLimit(std::uint64_t limit, std::uint64_t value)
+{
+	return limit != 0 && value > limit;
+}
+
+/**
+ * Fills the area of the canvas with single value.
+ *
+ * @param canvas The canvas of indices or colors.
+ * @param width The width of the canvas.
+ * @param height The height of the canvas.
+ * @param rect The area to fill, it is clipped to the canvas.
+ * @param value The value to fill with.
+ */
+template <typename T> static void fillArea(ArenaVector<T>& canvas, std::size_t width, std::size_t height, const GifDecoder::ImageDescriptor& rect, const T& value)
+{
+	std::size_t endX = std::min<std::size_t>(rect.x + rect.width, width);
+	std::size_t endY = std::min<std::size_t>(rect.y + rect.height, height);
+	for (std::size_t y = rect.y; y < endY; ++y)
+		for (std::size_t x = rect.x; x < endX; ++x)
+			canvas[y * width + x] = value;
+}
+
+/**
+ * Copies the area of the canvas row by row into the buffer.
+ *
+ * @param canvas The canvas of indices or colors.
+ * @param width The width of the canvas.
+ * @param height The height of the canvas.
+ * @param rect The area to copy, it is clipped to the canvas.
+ * @param to The buffer where to copy.
+ */
+template <typename T> static void copyArea(const ArenaVector<T>& canvas, std::size_t width, std::size_t height, const GifDecoder::ImageDescriptor& rect, ArenaVector<T>& to)
+{
+	std::size_t endX = std::min<std::size_t>(rect.x + rect.width, width);
+	std::size_t endY = std::min<std::size_t>(rect.y + rect.height, height);
+
+	// Buffer keeps its capacity, so it grows only for larger areas
+	to.clear();
+	if (endX > rect.x && endY > rect.y)
+		to.reserve((endX - rect.x) * (endY - rect.y));
+
+	for (std::size_t y = rect.y; y < endY; ++y)
+		for (std::size_t x = rect.x; x < endX; ++x)
+			to.push_back(canvas[y * width + x]);
+}
+
+/**
+ * Restores the area of the canvas from the buffer filled by copyArea().
+ *
+ * @param canvas The canvas of indices or colors.
+ * @param width The width of the canvas.
+ * @param height The height of the canvas.
+ * @param rect The area to restore, it is clipped to the canvas.
+ * @param from The buffer with saved area.
+ */
+template <typename T> static void restoreArea(ArenaVector<T>& canvas, std::size_t width, std::size_t height, const GifDecoder::ImageDescriptor& rect, const ArenaVector<T>& from)
+{
+	std::size_t endX = std::min<std::size_t>(rect.x + rect.width, width);
+	std::size_t endY = std::min<std::size_t>(rect.y + rect.height, height);
+
+	std::size_t pos = 0;
+	for (std::size_t y = rect.y; y < endY; ++y)
+		for (std::size_t x = rect.x; x < endX && pos < from.size(); ++x)
+			canvas[y * width + x] = from[pos++];
+}
+
+GifDecoder::GifDecoder() : GifDecoder(nullptr)
+{
+}
+
+GifDecoder::GifDecoder(FILE *gifFile) : _gifFile(gifFile), _gifMemory(), _input(), _threadPool(nullptr), _state(DECODER_STATE_SIGNATURE), _probeOnly(false), _threadCount(1), _streaming(false), _streamRows(false), _region(), _limits(), _limitExceeded(false), _startTime(std::chrono::steady_clock::now()), _arena(nullptr), _info(), _pending(), _gifData(), _gifDataOffset(0), _streamPos(0), _decodePos(0), _backgroundIndex(0), _backgroundColor(),
+	_subBlockRemaining(0), _imageSubBlocks(false), _imageDescriptor(), _graphicControl(), _localColorTable(false), _indexBuffer(), _codedData(), _lzwDecoder(nullptr), _spareLzwDecoder(nullptr), _rowsEmitted(0),
+	_windowFirstRow(0), _windowRows(0), _frameRows(0), _frameArea(), _rowMap(), _passEnds(), _passesReported(0), _globalPalette(), _localPalette(), _canvasX(0), _canvasY(0), _canvasWidth(0), _canvasHeight(0), _indexedCanvas(false), _canvasPalette(), _indexCanvas(), _canvas(), _previousFrame(),
+	_previousDisposal(DISPOSAL_METHOD_NONE), _previousIndices(), _previousCanvas(), _canvasRow(), _canvasRowsEmitted(0), _image(nullptr), _spareImage(nullptr),
+	_rowCallback(), _passCallback(), _imageCallback(), _canvasRowCallback()
 {
 }
 
@@ -31,104 +135,935 @@ GifDecoder::~GifDecoder()
 {
 }
 
+/**
+ * Decodes the whole GIF file given in constructor or by setFile(), or the memory given
+ * by setData(). Regular files are mapped and decoded at once like the memory, other
+ * inputs like pipes are decoded in chunks as soon as they arrive. If streaming or multiple threads are requested, the whole input
+ * is read first, so its structure can be probed before decoding.
+ *
+ * @return True if decoding was successful, otherwise false.
+ */
 bool GifDecoder::decode()
 {
-	_decodePos = 0;
-	_gifBuffer = DataBuffer::createFromFile(_gifFile);
-	if (_gifBuffer == nullptr)
+	if (_gifFile == nullptr && _gifMemory.getData() == nullptr)
+		return false;
+
+	reset();
+	bool result = decodeFile();
+
+	// Input is released right away, the object is kept for the next decoding
+	_input.close();
+	return result;
+}
+
+/**
+ * Decodes the file from the input. See decode().
+ *
+ * @return True if decoding was successful, otherwise false.
+ */
+bool GifDecoder::decodeFile()
+{
+	if ((_streaming || _threadCount != 1) && !_probeOnly)
+	{
+		if (!openInput(false))
+			return false;
+
+		DataView gifData = _input.getView();
+		if (_streaming && decodeStreaming(gifData))
+			return true;
+
+		// Streaming failed before anything was reported if GIF cannot be streamed
+		if (_streamRows || _limitExceeded)
+			return false;
+
+		if (_threadCount != 1)
+			return decodeParallel(gifData);
+
+		resetState();
+		return feed(gifData.getData(), gifData.getSize()) && finish();
+	}
+
+	if (openInput(true))
+	{
+		DataView gifData = _input.getView();
+		if (!feed(gifData.getData(), gifData.getSize()))
+			return false;
+	}
+	else
+	{
+		// Pipe is decoded by whatever amount of data has arrived, so the first rows do not wait for the whole chunk
+		ArenaVector<std::uint8_t> chunk(INPUT_CHUNK_SIZE, 0, _arena);
+		while (!isFinished())
+		{
+			std::size_t bytesRead = 0;
+			if (!readAvailable(_gifFile, chunk.data(), chunk.size(), bytesRead))
+				return false;
+
+			if (bytesRead == 0)
+				break;
+
+			if (!feed(chunk.data(), bytesRead))
+				return false;
+		}
+	}
+
+	return finish();
+}
+
+/**
+ * Opens the whole input, the memory given by setData() or the file.
+ *
+ * @param mappedOnly True if the file may be only mapped, false if it may be read into the buffer too.
+ *
+ * @return True if the input is open, otherwise false.
+ */
+bool GifDecoder::openInput(bool mappedOnly)
+{
+	if (_gifFile == nullptr)
+		return _input.openMemory(_gifMemory);
+
+	return mappedOnly ? _input.openMapped(_gifFile) : _input.open(_gifFile, _arena);
+}
+
+/**
+ * Walks only the block structure of the whole GIF file given in constructor
+ * and collects its metadata. Image data are skipped by the sizes of their
+ * sub-blocks without decoding, so no image is produced.
+ *
+ * @return True if the GIF structure is valid, otherwise false.
+ */
+bool GifDecoder::probe()
+{
+	bool probeOnly = _probeOnly;
+	setProbeOnly(true);
+	bool result = decode();
+	setProbeOnly(probeOnly);
+	return result;
+}
+
+/**
+ * Walks the block structure of the whole GIF in memory and collects its metadata
+ * without decoding the image data. See probe().
+ *
+ * @param gifData The whole GIF.
+ *
+ * @return True if the GIF structure is valid, otherwise false.
+ */
+bool GifDecoder::probeData(const DataView& gifData)
+{
+	resetState();
+	_probeOnly = true;
+	bool probed = feed(gifData.getData(), gifData.getSize()) && finish();
+	_probeOnly = false;
+	return probed;
+}
+
+/**
+ * Decodes the whole GIF in memory without keeping the canvas. This is possible only
+ * for GIF with single non-interlaced frame, whose rows come from top to bottom.
+ * Rows of the canvas are then reported through canvas row callback right when
+ * they are decoded and the frame is decoded only into small window of rows,
+ * so the memory does not depend on the height of the image. No image is created.
+ *
+ * @param gifData The whole GIF.
+ *
+ * @return True if decoding was successful, false if it failed or GIF cannot be streamed.
+ */
+bool GifDecoder::decodeStreaming(const DataView& gifData)
+{
+	if (!probeData(gifData))
+		return false;
+
+	if (_info.frames.size() != 1 || _info.frames.front().descriptor.interlaced || _info.width == 0 || _info.height == 0)
+		return false;
+
+	resetState();
+	_streamRows = true;
+	return feed(gifData.getData(), gifData.getSize()) && finish();
+}
+
+/**
+ * Decodes the whole GIF in memory using multiple threads. The block structure is
+ * walked first to find the data of all frames. LZW data of frames are then decoded
+ * in parallel while frames are composited into canvas in their order as soon as
+ * they are decoded. Only a limited number of frames is decoded ahead.
+ *
+ * @param gifData The whole GIF.
+ *
+ * @return True if decoding was successful, otherwise false.
+ */
+bool GifDecoder::decodeParallel(const DataView& gifData)
+{
+	if (!probeData(gifData))
+		return false;
+
+	GifInfo info = std::move(_info);
+	resetState();
+	_info = std::move(info);
+	_state = DECODER_STATE_TERMINATED;
+
+	_backgroundIndex = _info.backgroundIndex;
+	if (_info.colorTableSize > 0)
+	{
+		if (!_globalPalette.load(gifData.getSubView(_info.colorTableOffset, _info.colorTableSize * 3)))
+			return false;
+
+		_backgroundColor = _globalPalette[_backgroundIndex];
+	}
+
+	const std::vector<FrameInfo>& frames = _info.frames;
+	if (frames.empty())
+		return finish();
+
+	// Canvas has to be placed before frames are decoded, so that only rows needed by the region are decoded
+	if (!placeCanvas(frames.front().descriptor))
+		return false;
+
+	// Index buffers of composited frames are reused by the next frames, so only the frames decoded ahead hold their own buffers
+	std::vector<DataBuffer> indexBuffers(frames.size());
+	std::vector<DataBuffer> spareBuffers;
+	std::vector<char> decoded(frames.size(), false);
+	std::vector<std::future<void>> results(frames.size());
+
+	// Tasks which have not started yet skip their frames once decoding is stopped
+	std::atomic<bool> stopped(false);
+
+	// Threads are kept for the next decoding with the same number of threads
+	std::size_t threadCount = _threadCount == 0 ? ThreadPool::defaultThreadCount() : _threadCount;
+	if (_threadPool == nullptr || _threadPool->getThreadCount() != threadCount)
+		_threadPool = std::make_unique<ThreadPool>(threadCount);
+
+	ThreadPool& threadPool = *_threadPool;
+	std::size_t aheadCount = threadPool.getThreadCount() * 2;
+
+	// Large frames are not submitted, they are split into more tasks once they are next to composite
+	auto submitFrame = [&](std::size_t frame) {
+		if (spareBuffers.empty())
+			indexBuffers[frame] = DataBuffer(0, _arena);
+		else
+		{
+			indexBuffers[frame] = std::move(spareBuffers.back());
+			spareBuffers.pop_back();
+		}
+
+		if (frames[frame].descriptor.width * neededRows(frames[frame].descriptor) >= SEGMENTED_FRAME_MIN_SIZE)
+			return;
+
+		// Buffer is allocated here, so the tasks never allocate from the arena and it needs no locking
+		indexBuffers[frame].resize(frames[frame].descriptor.width * neededRows(frames[frame].descriptor));
+		results[frame] = threadPool.submit([&, frame]() {
+				decoded[frame] = !stopped && decodeFrame(gifData, frames[frame], indexBuffers[frame]);
+			});
+	};
+
+	for (std::size_t frame = 0; frame < std::min(aheadCount, frames.size()); ++frame)
+		submitFrame(frame);
+
+	bool result = true;
+	std::size_t frame = 0;
+	for (; frame < frames.size() && result; ++frame)
+	{
+		// Frames are not decoded any further once the time is up, tasks of frames decoded ahead check it too
+		if (timeExceeded())
+		{
+			limitExceeded();
+			result = false;
+			break;
+		}
+
+		if (results[frame].valid())
+			results[frame].wait();
+		else
+			decoded[frame] = decodeFrameSegments(gifData, frames[frame], indexBuffers[frame], threadPool);
+
+		// The first frame which fails ends decoding, frames after it are not needed
+		result = decoded[frame] && compositeFrame(gifData, frames[frame], indexBuffers[frame]);
+
+		// Compositing swapped the buffer of this frame with the one of the previous frame, which is no longer needed
+		spareBuffers.push_back(std::move(indexBuffers[frame]));
+		if (result && frame + aheadCount < frames.size())
+			submitFrame(frame + aheadCount);
+	}
+
+	// Only the tasks which are already running are waited for, the rest skip their frames
+	stopped = true;
+	for (; frame < frames.size(); ++frame)
+	{
+		if (results[frame].valid())
+			results[frame].wait();
+	}
+
+	// The last frame could fail because its task found the time up
+	if (!result && !_limitExceeded && timeExceeded())
+		limitExceeded();
+
+	if (!result)
+		return false;
+
+	return finish();
+}
+
+/**
+ * Decodes LZW data of single frame into its index buffer. It only reads
+ * the GIF data, so it can run in parallel for multiple frames. Decoding stops
+ * after the last row which is needed by the canvas.
+ *
+ * @param gifData The whole GIF.
+ * @param frameInfo The frame to decode.
+ * @param indexBuffer The buffer where to decode, already sized for the needed rows of the frame.
+ *
+ * @return True if decoding was successful, false for malformed data or if the time limit is exceeded.
+ */
+bool GifDecoder::decodeFrame(const DataView& gifData, const FrameInfo& frameInfo, DataBuffer& indexBuffer) const
+{
+	if (frameInfo.minCodeSize >= MAX_CODE_SIZE || timeExceeded())
+		return false;
+
+	SubBlockReader subBlocks(gifData, frameInfo.dataOffset);
+	LzwDecoder lzwDecoder(frameInfo.minCodeSize + 1, 1 << frameInfo.minCodeSize);
+	if (!lzwDecoder.decode(subBlocks, indexBuffer.getRawData(), indexBuffer.getSize(), _backgroundIndex))
+		return false;
+
+	return subBlocks.skipToEnd();
+}
+
+/**
+ * Decodes LZW data of single large frame using multiple threads. Coded data are
+ * scanned for clear codes first, which gives independent segments and their decoded
+ * sizes. Consecutive segments are grouped into parts of similar size and each part
+ * is decoded right into its place in the index buffer. If there are no clear codes,
+ * the frame is decoded by the calling thread.
+ *
+ * @param gifData The whole GIF.
+ * @param frameInfo The frame to decode.
+ * @param indexBuffer The buffer where to decode.
+ * @param threadPool The pool which decodes the parts.
+ *
+ * @return True if decoding was successful, false for malformed data or if the time limit is exceeded.
+ */
+bool GifDecoder::decodeFrameSegments(const DataView& gifData, const FrameInfo& frameInfo, DataBuffer& indexBuffer, ThreadPool& threadPool)
+{
+	if (frameInfo.minCodeSize >= MAX_CODE_SIZE)
+		return false;
+
+	// Frame which is mostly outside of the region is decoded only up to its last needed row
+	std::size_t decodedSize = frameInfo.descriptor.width * neededRows(frameInfo.descriptor);
+	indexBuffer.resize(decodedSize);
+	if (decodedSize < SEGMENTED_FRAME_MIN_SIZE)
+		return decodeFrame(gifData, frameInfo, indexBuffer);
+
+	// Bit positions of segments are counted without sub-block size bytes, so the coded data are joined first
+	// The buffer is kept for the next large frame
+	DataBuffer& codedData = _codedData;
+	codedData.resize(0);
+	SubBlockReader subBlocks(gifData, frameInfo.dataOffset);
+	const std::uint8_t* data;
+	std::size_t size;
+	while (subBlocks.next(data, size))
+		codedData.append(DataView(data, size));
+
+	if (!subBlocks.skipToEnd())
+		return false;
+
+	std::vector<LzwDecoder::Segment> segments;
+	if (!LzwDecoder::scanSegments(codedData.getRawData(), codedData.getSize(), frameInfo.minCodeSize + 1, 1 << frameInfo.minCodeSize, segments))
+		return false;
+
+	if (segments.size() < 2)
+		return decodeFrame(gifData, frameInfo, indexBuffer);
+
+	if (timeExceeded())
+		return false;
+
+	// Offsets of parts in the index buffer are the prefix sums of decoded sizes
+	std::size_t partSize = indexBuffer.getSize() / (threadPool.getThreadCount() * SEGMENTED_FRAME_PARTS_PER_THREAD) + 1;
+	std::vector<LzwDecoder::Segment> parts;
+	std::vector<std::size_t> offsets;
+	std::size_t offset = 0;
+	for (const auto& segment : segments)
+	{
+		if (offset >= indexBuffer.getSize())
+			break;
+
+		if (parts.empty() || parts.back().decodedSize >= partSize)
+		{
+			parts.push_back(LzwDecoder::Segment{segment.bitPos, 0});
+			offsets.push_back(offset);
+		}
+
+		std::size_t decodedSize = static_cast<std::size_t>(std::min<std::uint64_t>(segment.decodedSize, indexBuffer.getSize() - offset));
+		parts.back().decodedSize += decodedSize;
+		offset += decodedSize;
+	}
+
+	std::vector<char> decoded(parts.size(), false);
+	std::vector<std::future<void>> results;
+	for (std::size_t part = 0; part < parts.size(); ++part)
+	{
+		results.push_back(threadPool.submit([&, part]() {
+				// Parts which start after the time is up are not decoded, so the frame fails
+				if (timeExceeded())
+					return;
+
+				LzwDecoder lzwDecoder(frameInfo.minCodeSize + 1, 1 << frameInfo.minCodeSize);
+				decoded[part] = lzwDecoder.decode(codedData.getRawData(), codedData.getSize(), parts[part].bitPos,
+					indexBuffer.getRawData() + offsets[part], static_cast<std::size_t>(parts[part].decodedSize));
+			}));
+	}
+
+	for (auto& partResult : results)
+		partResult.wait();
+
+	// Pixels not covered by the coded data
+	std::fill(indexBuffer.getRawData() + offset, indexBuffer.getRawData() + indexBuffer.getSize(), _backgroundIndex);
+
+	return std::all_of(decoded.begin(), decoded.end(), [](char partDecoded) { return partDecoded != 0; });
+}
+
+/**
+ * Composites already decoded frame into the canvas.
+ *
+ * @param gifData The whole GIF.
+ * @param frameInfo The frame to composite.
+ * @param indexBuffer Decoded indices of the frame.
+ *
+ * @return True if compositing was successful, otherwise false.
+ */
+bool GifDecoder::compositeFrame(const DataView& gifData, const FrameInfo& frameInfo, DataBuffer& indexBuffer)
+{
+	if (frameInfo.colorTableSize > 0)
+	{
+		if (!_localPalette.load(gifData.getSubView(frameInfo.colorTableOffset, frameInfo.colorTableSize * 3)))
+			return false;
+
+		_localColorTable = true;
+	}
+
+	if (currentPalette() == nullptr)
 		return false;
 
-	if (!decodeSignature())
+	_imageDescriptor = frameInfo.descriptor;
+	_graphicControl = frameInfo.control;
+	std::swap(_indexBuffer, indexBuffer);
+	_rowsEmitted = 0;
+
+	if (!startFrame())
 		return false;
 
-	if (!decodeLogicalScreenDescriptor())
+	_windowFirstRow = 0;
+	_windowRows = _frameRows;
+	emitRows(_frameRows);
+	completeFrame();
+	return true;
+}
+
+/**
+ * Resets the decoder to the state before the first chunk of data, so it can be
+ * used to decode another GIF. Time limit is counted from here.
+ */
+void GifDecoder::reset()
+{
+	resetState();
+	_startTime = std::chrono::steady_clock::now();
+}
+
+/**
+ * Resets the state of decoding, but not the time when decoding started.
+ */
+void GifDecoder::resetState()
+{
+	_limitExceeded = false;
+	_state = DECODER_STATE_SIGNATURE;
+	// Containers of the decoder keep their capacity for the next decoding
+	std::vector<FrameInfo> frames = std::move(_info.frames);
+	frames.clear();
+	_info = GifInfo();
+	_info.frames = std::move(frames);
+	_pending = DataBuffer(0, _arena);
+	_gifData = DataView();
+	_gifDataOffset = 0;
+	_streamPos = 0;
+	_decodePos = 0;
+	_backgroundIndex = 0;
+	_backgroundColor = Color();
+	_subBlockRemaining = 0;
+	_imageSubBlocks = false;
+	_graphicControl = GraphicControl();
+	_localColorTable = false;
+	_indexBuffer = DataBuffer(0, _arena);
+	_codedData = DataBuffer(0, _arena);
+	releaseLzwDecoder();
+	_rowsEmitted = 0;
+	_windowFirstRow = _windowRows = 0;
+	_frameRows = 0;
+	_frameArea = ImageDescriptor();
+	_rowMap.clear();
+	_passesReported = 0;
+	_streamRows = false;
+	_globalPalette.clear();
+	_localPalette.clear();
+	_canvasX = _canvasY = 0;
+	_canvasWidth = _canvasHeight = 0;
+	_indexedCanvas = false;
+	_canvasPalette.clear();
+	_indexCanvas = ArenaVector<std::uint8_t>(_arena);
+	_canvas = ArenaVector<Color>(_arena);
+	_previousDisposal = DISPOSAL_METHOD_NONE;
+	_previousIndices = ArenaVector<std::uint8_t>(_arena);
+	_previousCanvas = ArenaVector<Color>(_arena);
+	_canvasRow = ArenaVector<Color>(_arena);
+	_canvasRowsEmitted = 0;
+	releaseImage();
+}
+
+/**
+ * Decodes the next chunk of data. Rows and images are reported through callbacks
+ * as soon as they are decoded. Block which is split between this and the next chunk
+ * is decoded once the next chunk is fed. Data after the trailer are ignored.
+ *
+ * @param data The chunk of data.
+ * @param size The size of the chunk.
+ *
+ * @return True if decoding was successful so far, otherwise false.
+ */
+bool GifDecoder::feed(const std::uint8_t* data, std::size_t size)
+{
+	if (_state == DECODER_STATE_ERROR)
 		return false;
 
-	std::uint64_t blockCounter = 0;
-	while (nextDataBlock())
+	// Finish the block which was split between previous and this chunk first
+	// Only as much data as the largest block is copied, the rest is decoded right from the chunk
+	while (_pending.getSize() > 0 && size > 0)
 	{
-		print("Block #", blockCounter++);
-		if (!decodeDataBlock())
+		std::size_t pendingSize = _pending.getSize();
+		std::size_t amount = std::min(size, MAX_BLOCK_SIZE);
+		_pending.append(DataView(data, amount));
+
+		if (!parse(DataView(_pending), _streamPos - pendingSize))
 			return false;
+
+		if (_decodePos >= pendingSize)
+		{
+			std::size_t used = _decodePos - pendingSize;
+			data += used;
+			size -= used;
+			_streamPos += used;
+			_pending.resize(0);
+		}
+		else
+		{
+			_pending.erase(0, _decodePos);
+			data += amount;
+			size -= amount;
+			_streamPos += amount;
+		}
 	}
 
+	if (size == 0)
+		return true;
+
+	if (!parse(DataView(data, size), _streamPos))
+		return false;
+
+	_streamPos += size;
+
+	// Keep the start of the split block for the next chunk
+	// Split block and the chunk appended to it never need more than two largest blocks
+	if (_decodePos < size)
+	{
+		_pending.reserve(2 * MAX_BLOCK_SIZE);
+		_pending.append(DataView(data + _decodePos, size - _decodePos));
+	}
+
+	return true;
+}
+
+/**
+ * Finishes decoding after all data were fed. Missing trailer is tolerated
+ * but the data must not end in the middle of the block. The last composited
+ * frame is then available through getImage().
+ *
+ * @return True if the GIF was decoded successfully, otherwise false.
+ */
+bool GifDecoder::finish()
+{
+	if (_state != DECODER_STATE_TERMINATED && (_state != DECODER_STATE_DATA_BLOCK || _pending.getSize() != 0))
+		return false;
+
+	// Decoding is over, so the canvas is moved into the image
+	if (_image == nullptr && (!_canvas.empty() || !_indexCanvas.empty()))
+		_image = createImage();
+
 	return true;
 }
 
+/**
+ * Returns whether the trailer was hit.
+ *
+ * @return True if the whole GIF was decoded, otherwise false.
+ */
+bool GifDecoder::isFinished() const
+{
+	return _state == DECODER_STATE_TERMINATED;
+}
+
+/**
+ * Sets whether only the block structure should be walked and metadata collected
+ * without decoding the image data. See probe().
+ *
+ * @param probeOnly True for probing only.
+ */
+void GifDecoder::setProbeOnly(bool probeOnly)
+{
+	_probeOnly = probeOnly;
+}
+
+/**
+ * Sets the file which is decoded by the next decode(). Decoder can be reused for
+ * any number of files, its buffers, LZW decoder and threads are then
+ * allocated only once.
+ *
+ * @param gifFile The GIF file.
+ */
+void GifDecoder::setFile(FILE *gifFile)
+{
+	_gifFile = gifFile;
+	_gifMemory = DataView();
+}
+
+/**
+ * Sets the memory with the whole GIF which is decoded by the next decode() instead
+ * of the file. Nothing is copied, GIF is decoded right from the memory, which has
+ * to be valid until decode() returns.
+ *
+ * @param gifData The whole GIF.
+ */
+void GifDecoder::setData(const DataView& gifData)
+{
+	_gifFile = nullptr;
+	_gifMemory = gifData;
+}
+
+/**
+ * Sets the number of threads used by decode(). If it is other than 1, the whole
+ * input is read first and frames are decoded in parallel. See decodeParallel().
+ *
+ * @param threadCount The number of threads, 0 for the number of CPUs.
+ */
+void GifDecoder::setThreadCount(std::size_t threadCount)
+{
+	_threadCount = threadCount;
+}
+
+/**
+ * Sets whether decode() should stream rows of the canvas through canvas row callback
+ * instead of keeping the whole canvas. If the GIF cannot be streamed, it is decoded
+ * into the canvas as usual. See decodeStreaming(). GIF has to be probed first, so input
+ * which cannot be mapped, like a pipe, is read whole before any row is reported.
+ *
+ * @param streaming True for streaming.
+ */
+void GifDecoder::setStreaming(bool streaming)
+{
+	_streaming = streaming;
+}
+
+/**
+ * Sets the region of the logical screen which is decoded. Canvas and the images cover
+ * only this region and decoding of every frame stops after its last row
+ * inside of the region, so the row callback gets only the rows up to it.
+ * Region of zero width or height is the whole logical screen.
+ *
+ * @param region The region to decode, it is clipped to the logical screen.
+ */
+void GifDecoder::setRegion(const ImageDescriptor& region)
+{
+	_region = region;
+}
+
+/**
+ * Sets limits of resources for decoding of untrusted GIF. Decoding fails as soon as any
+ * of the limits is exceeded, which can be told from other failures by isLimitExceeded().
+ *
+ * @param limits The limits.
+ */
+void GifDecoder::setLimits(const Limits& limits)
+{
+	_limits = limits;
+}
+
+/**
+ * Sets the arena from which the input, index buffers and the canvas are allocated
+ * by the next decode(). The final image is moved from the canvas, so it is in
+ * the arena as well. The arena must not be reset while the decoder or its image
+ * are in use, images of frames passed to the image callback are on the heap.
+ *
+ * @param arena The arena, nullptr for the heap.
+ */
+void GifDecoder::setArena(Arena* arena)
+{
+	_arena = arena;
+}
+
+/**
+ * Sets the callback which is called for every row of every image as soon as the row is decoded.
+ * Rows of interlaced images are reported in the order in which they are stored in GIF.
+ *
+ * @param callback The callback.
+ */
+void GifDecoder::setRowCallback(const RowCallback& callback)
+{
+	_rowCallback = callback;
+}
+
+/**
+ * Sets the callback which is called for every frame once it is decoded and composited.
+ * The image passed to the callback is the whole canvas.
+ *
+ * @param callback The callback.
+ */
+void GifDecoder::setImageCallback(const ImageCallback& callback)
+{
+	_imageCallback = callback;
+}
+
+/**
+ * Sets the callback which is called for every pass of interlaced image once all its rows
+ * were reported to the row callback and composited. Rows of the first pass,
+ * which are every 8th row of the image, make low resolution preview of the whole image.
+ *
+ * @param callback The callback.
+ */
+void GifDecoder::setPassCallback(const PassCallback& callback)
+{
+	_passCallback = callback;
+}
+
+/**
+ * Sets the callback which is called for every row of the canvas when the rows
+ * are streamed, from top to bottom. See setStreaming().
+ *
+ * @param callback The callback.
+ */
+void GifDecoder::setCanvasRowCallback(const CanvasRowCallback& callback)
+{
+	_canvasRowCallback = callback;
+}
+
 const Image* GifDecoder::getImage() const
 {
 	return _image.get();
 }
 
-bool GifDecoder::enoughData(std::uint64_t amount)
+/**
+ * Returns the metadata collected so far.
+ *
+ * @return Metadata of the GIF.
+ */
+const GifDecoder::GifInfo& GifDecoder::getInfo() const
 {
-	return (_gifBuffer ? (_decodePos + amount < _gifBuffer->getSize()) : false);
+	return _info;
 }
 
-bool GifDecoder::nextDataBlock()
+/**
+ * Tells whether the last decoding failed because some of the limits was exceeded.
+ *
+ * @return True if the limit was exceeded, otherwise false.
+ */
+bool GifDecoder::isLimitExceeded() const
 {
-	if (!enoughData(1))
+	return _limitExceeded;
+}
+
+std::uint16_t GifDecoder::getCanvasWidth() const
+{
+	return _canvasWidth;
+}
+
+std::uint16_t GifDecoder::getCanvasHeight() const
+{
+	return _canvasHeight;
+}
+
+/**
+ * Decodes as many blocks from the data as possible. Decoding stops at the
+ * block which does not fit into the data, _decodePos then points to its start.
+ *
+ * @param data The data to decode.
+ * @param offset The offset of the data from the start of GIF.
+ *
+ * @return True if decoding was successful so far, otherwise false.
+ */
+bool GifDecoder::parse(const DataView& data, std::uint64_t offset)
+{
+	_gifData = data;
+	_gifDataOffset = offset;
+	_decodePos = 0;
+
+	while (_state != DECODER_STATE_TERMINATED)
+	{
+		std::size_t blockStart = _decodePos;
+		DecodeResult result = decodeNext();
+		if (result == DECODE_NEED_DATA)
+		{
+			_decodePos = blockStart;
+			break;
+		}
+		else if (result == DECODE_ERROR)
+		{
+			_state = DECODER_STATE_ERROR;
+			return false;
+		}
+	}
+
+	// Everything after the trailer is ignored
+	if (_state == DECODER_STATE_TERMINATED)
+		_decodePos = _gifData.getSize();
+
+	return true;
+}
+
+DecodeResult GifDecoder::decodeNext()
+{
+	switch (_state)
+	{
+		case DECODER_STATE_SIGNATURE:
+			return decodeSignature();
+		case DECODER_STATE_LOGICAL_SCREEN_DESCRIPTOR:
+			return decodeLogicalScreenDescriptor();
+		case DECODER_STATE_DATA_BLOCK:
+			return decodeDataBlock();
+		case DECODER_STATE_SUB_BLOCKS:
+			return decodeSubBlocks();
+		default:
+			return DECODE_ERROR;
+	}
+}
+
+bool GifDecoder::enoughData(std::size_t amount)
+{
+	return (_decodePos + amount <= _gifData.getSize());
+}
+
+/**
+ * Checks the time spent by decoding against the time limit.
+ *
+ * @return True if the time limit is exceeded, otherwise false.
+ */
+bool GifDecoder::timeExceeded() const
+{
+	if (_limits.maxTime == 0)
 		return false;
 
-	return (_gifBuffer->read(_decodePos, 1).getInt<std::uint8_t>() != BLOCK_ID_TERMINAL);
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _startTime);
+	return exceedsLimit(_limits.maxTime, static_cast<std::uint64_t>(elapsed.count()));
 }
 
-bool GifDecoder::decodeSignature()
+/**
+ * Returns whether the current frame expands from its coded data more than allowed.
+ *
+ * @param pixels Pixels of the frame produced from the coded data read so far.
+ *
+ * @return True if the expansion ratio limit is exceeded, otherwise false.
+ */
+bool GifDecoder::expansionExceeded(std::uint64_t pixels) const
 {
-	if (!enoughData(6))
+	if (_limits.maxExpansionRatio == 0)
 		return false;
 
-	DataBuffer signatureBuffer = _gifBuffer->getSubBuffer(_decodePos, 6);
+	return pixels > _info.frames.back().compressedSize * _limits.maxExpansionRatio;
+}
+
+/**
+ * Marks that some of the limits was exceeded and decoding has to stop.
+ *
+ * @return Always DECODE_ERROR.
+ */
+DecodeResult GifDecoder::limitExceeded()
+{
+	print("Limit exceeded");
+	_limitExceeded = true;
+	return DECODE_ERROR;
+}
+
+DecodeResult GifDecoder::decodeSignature()
+{
+	if (!enoughData(6))
+		return DECODE_NEED_DATA;
+
+	DataView signatureBuffer = _gifData.getSubView(_decodePos, 6);
 	_decodePos += 6;
 
 	std::string signature = signatureBuffer.read(0, 6).getString();
 	print("GIF Version: ", signature);
 
-	return (signature == "GIF89a" || signature == "GIF87a");
+	if (signature != "GIF89a" && signature != "GIF87a")
+		return DECODE_ERROR;
+
+	_state = DECODER_STATE_LOGICAL_SCREEN_DESCRIPTOR;
+	return DECODE_OK;
 }
 
-bool GifDecoder::decodeLogicalScreenDescriptor()
+DecodeResult GifDecoder::decodeLogicalScreenDescriptor()
 {
 	if (!enoughData(7))
-		return false;
+		return DECODE_NEED_DATA;
 
-	DataBuffer lsdBuffer = _gifBuffer->getSubBuffer(_decodePos, 7);
+	DataView lsdBuffer = _gifData.getSubView(_decodePos, 7);
 	_decodePos += 7;
 
-	std::uint16_t gifWidth = lsdBuffer.read(0, 2).getInt<std::uint16_t>();
-	std::uint16_t gifHeight = lsdBuffer.read(2, 2).getInt<std::uint16_t>();
-	std::uint8_t bgColorIdx = lsdBuffer.read(5, 1).getInt<std::uint8_t>();
-	bool gctPresent = lsdBuffer.readBits(4, 7, 1).getBool();
+	std::uint16_t gifWidth = lsdBuffer.read<std::uint16_t>(0);
+	std::uint16_t gifHeight = lsdBuffer.read<std::uint16_t>(2);
+	std::uint8_t bgColorIdx = lsdBuffer.read<std::uint8_t>(5);
+	bool gctPresent = lsdBuffer.bits<bool>(4, 7, 1);
+	std::uint16_t gctEntries = 0;
 
 	print("Width x Height: ", gifWidth, " x ", gifHeight);
 	print("Uses global color table: ", gctPresent ? "Yes" : "No");
+
+	if (exceedsLimit(_limits.maxPixels, static_cast<std::uint64_t>(gifWidth) * gifHeight))
+		return limitExceeded();
+
 	print("Background color index: ", static_cast<std::uint16_t>(bgColorIdx));
 
 	if (gctPresent)
 	{
-		std::uint32_t gctSize = (1 << (lsdBuffer.readBits(4, 0, 3).getInt<std::uint8_t>() + 1)) * 3;
+		gctEntries = 1 << (lsdBuffer.bits<std::uint8_t>(4, 0, 3) + 1);
+		std::uint32_t gctSize = gctEntries * 3;
 		print("Global color table size: ", gctSize, std::hex, " (0x", gctSize, ")", std::dec);
 
 		if (!enoughData(gctSize))
-			return false;
+			return DECODE_NEED_DATA;
 
 		// Global Color Table
-		DataBuffer gct = _gifBuffer->getSubBuffer(_decodePos, gctSize);
+		_info.colorTableOffset = _gifDataOffset + _decodePos;
+		DataView gct = _gifData.getSubView(_decodePos, gctSize);
 		_decodePos += gctSize;
 
-		if (!newColorTable(gct))
-			return false;
+		if (!_probeOnly && !_globalPalette.load(gct))
+			return DECODE_ERROR;
+
+		// Colors after the end of color table are black, just as background outside of it
+		if (!_probeOnly)
+			_backgroundColor = _globalPalette[bgColorIdx];
 	}
 
-	return true;
+	_info.width = gifWidth;
+	_info.height = gifHeight;
+	_info.colorTableSize = gctEntries;
+	_info.backgroundIndex = bgColorIdx;
+
+	_backgroundIndex = bgColorIdx;
+	_state = DECODER_STATE_DATA_BLOCK;
+	return DECODE_OK;
 }
 
-bool GifDecoder::decodeDataBlock()
+DecodeResult GifDecoder::decodeDataBlock()
 {
 	if (!enoughData(1))
-		return false;
+		return DECODE_NEED_DATA;
 
-	std::uint8_t dataBlockCode = _gifBuffer->read(_decodePos++, 1).getInt<std::uint8_t>();
+	std::uint8_t dataBlockCode = _gifData.read<std::uint8_t>(_decodePos++);
 
 	// <Data> ::=                <Graphic Block>  |
 	//                           <Special-Purpose Block>
@@ -148,255 +1083,785 @@ bool GifDecoder::decodeDataBlock()
 		// Image Descriptor identifier
 		case BLOCK_ID_IMAGE_DESCRIPTOR:
 			print("Image Descriptor Block");
-			if (!decodeTableBasedImage())
-				return false;
-			break;
+			return decodeTableBasedImage();
 		// Extension identifier
 		case BLOCK_ID_EXTENSION:
 		{
 			if (!enoughData(1))
-				return false;
+				return DECODE_NEED_DATA;
 
-			dataBlockCode = _gifBuffer->read(_decodePos++, 1).getInt<std::uint8_t>();
+			dataBlockCode = _gifData.read<std::uint8_t>(_decodePos++);
 			switch (dataBlockCode)
 			{
-				// Plain Text Extension
-				case EXTENSION_ID_PLAIN_TEXT:
-					assert(false && "Plain Text Extension");
-					// decodePlainTextExtension();
-					break;
 				// Graphic Control Extension
 				case EXTENSION_ID_GRAPHIC_CONTROL:
 					print("Graphic Control Extension");
-					if (!decodeGraphicBlock())
-						return false;
-					break;
-				// Commnet Extension
-				case EXTENSION_ID_COMMENT:
-					assert(false && "Comment Extension");
-					// decodeCommentExtension();
-					break;
+					return decodeGraphicBlock();
+				// Plain Text Extension
+				// Comment Extension
 				// Application Extension
+				// These are not rendered, all their sub-blocks are just skipped
+				case EXTENSION_ID_PLAIN_TEXT:
+				case EXTENSION_ID_COMMENT:
 				case EXTENSION_ID_APPLICATION:
-					assert(false && "Application Extension");
-					// decodeApplicationExtension();
-					break;
+					print("Skipped Extension ", std::hex, static_cast<std::uint16_t>(dataBlockCode), std::dec);
+					_subBlockRemaining = 0;
+					_imageSubBlocks = false;
+					_state = DECODER_STATE_SUB_BLOCKS;
+					return DECODE_OK;
 				default:
-					return false;
+					return DECODE_ERROR;
 			}
-
-			break;
 		}
+		// Trailer
+		case BLOCK_ID_TERMINAL:
+			print("Trailer");
+			_state = DECODER_STATE_TERMINATED;
+			return DECODE_OK;
 		default:
-			return false;
+			return DECODE_ERROR;
 	}
-
-	return true;
 }
 
-bool GifDecoder::decodeTableBasedImage()
+DecodeResult GifDecoder::decodeTableBasedImage()
 {
 	if (!enoughData(9))
-		return false;
+		return DECODE_NEED_DATA;
 
-	DataBuffer imgDesc = _gifBuffer->getSubBuffer(_decodePos, 9);
+	DataView imgDesc = _gifData.getSubView(_decodePos, 9);
 	_decodePos += 9;
 
-	std::uint16_t imageX = imgDesc.read(0, 2).getInt<std::uint16_t>();
-	std::uint16_t imageY = imgDesc.read(2, 2).getInt<std::uint16_t>();
-	std::uint16_t imageWidth = imgDesc.read(4, 2).getInt<std::uint16_t>();
-	std::uint16_t imageHeight = imgDesc.read(6, 2).getInt<std::uint16_t>();
-	bool lctPresent = imgDesc.readBits(8, 7, 1).getBool();
-	bool interlaced = imgDesc.readBits(8, 6, 1).getBool();
-	print("X x Y: ", imageX, " x ", imageY);
-	print("Width x Height: ", imageWidth, " x ", imageHeight);
+	ImageDescriptor descriptor;
+	descriptor.x = imgDesc.read<std::uint16_t>(0);
+	descriptor.y = imgDesc.read<std::uint16_t>(2);
+	descriptor.width = imgDesc.read<std::uint16_t>(4);
+	descriptor.height = imgDesc.read<std::uint16_t>(6);
+	descriptor.interlaced = imgDesc.bits<bool>(8, 6, 1);
+	bool lctPresent = imgDesc.bits<bool>(8, 7, 1);
+	print("X x Y: ", descriptor.x, " x ", descriptor.y);
+	print("Width x Height: ", descriptor.width, " x ", descriptor.height);
 	print("Uses local color table: ", lctPresent ? "Yes" : "No");
-	print("Interlaced: ", interlaced ? "Yes" : "No");
+	print("Interlaced: ", descriptor.interlaced ? "Yes" : "No");
 
+	DataView lct;
+	std::uint16_t lctEntries = 0;
+	std::uint64_t lctOffset = 0;
 	if (lctPresent)
 	{
-		std::uint32_t lctSize = (1 << (imgDesc.readBits(8, 0, 3).getInt<std::uint8_t>() + 1)) * 3;
+		lctEntries = 1 << (imgDesc.bits<std::uint8_t>(8, 0, 3) + 1);
+		std::uint32_t lctSize = lctEntries * 3;
 		print("Local color table size: ", lctSize, std::hex, " (0x", lctSize, ")", std::dec);
 
 		if (!enoughData(lctSize))
-			return false;
+			return DECODE_NEED_DATA;
 
 		// Local Color Table
-		DataBuffer lct = _gifBuffer->getSubBuffer(_decodePos, lctSize);
+		lctOffset = _gifDataOffset + _decodePos;
+		lct = _gifData.getSubView(_decodePos, lctSize);
 		_decodePos += lctSize;
-
-		if (!newColorTable(lct))
-			return false;
 	}
 
 	// Image Data
-	if (!enoughData(2))
-		return false;
-
-	std::uint8_t minCodeSize = _gifBuffer->read(_decodePos++, 1).getInt<std::uint8_t>();
-	std::uint8_t dataSize = _gifBuffer->read(_decodePos++, 1).getInt<std::uint8_t>();
-
-	DataBuffer compressedData;
-	while (dataSize != 0)
+	if (!enoughData(1))
+		return DECODE_NEED_DATA;
+
+	std::uint8_t minCodeSize = _gifData.read<std::uint8_t>(_decodePos++);
+	if (minCodeSize >= MAX_CODE_SIZE)
+		return DECODE_ERROR;
+
+	// Limits are checked from the descriptor before anything is allocated for the frame
+	std::uint64_t framePixels = static_cast<std::uint64_t>(descriptor.width) * descriptor.height;
+	if (exceedsLimit(_limits.maxFrames, _info.frames.size() + 1) || exceedsLimit(_limits.maxPixels, framePixels)
+		|| exceedsLimit(_limits.maxDecodedPixels, _info.pixelCount + framePixels))
+		return limitExceeded();
+
+	FrameInfo frameInfo;
+	frameInfo.descriptor = descriptor;
+	frameInfo.control = _graphicControl;
+	frameInfo.colorTableSize = lctEntries;
+	frameInfo.colorTableOffset = lctOffset;
+	frameInfo.dataOffset = _gifDataOffset + _decodePos;
+	frameInfo.minCodeSize = minCodeSize;
+	_info.frames.push_back(frameInfo);
+	_info.pixelCount += framePixels;
+
+	_subBlockRemaining = 0;
+	_imageSubBlocks = true;
+	_state = DECODER_STATE_SUB_BLOCKS;
+
+	// Image data sub-blocks are only skipped when probing
+	if (_probeOnly)
 	{
-		// +1 for terminator
-		if (!enoughData(dataSize))
-			return false;
-
-		DataBuffer dataSubblocks = _gifBuffer->getSubBuffer(_decodePos, dataSize);
-		_decodePos += dataSize;
-
-		compressedData.append(dataSubblocks);
-
-		if (!enoughData(1))
-			return false;
-		dataSize = _gifBuffer->read(_decodePos++, 1).getInt<std::uint8_t>();
+		_graphicControl = GraphicControl();
+		return DECODE_OK;
 	}
 
-	print("LZW compressed data with min code ", static_cast<std::uint16_t>(minCodeSize), " and size ", compressedData.getSize());
+	if (lctPresent && !_localPalette.load(lct))
+		return DECODE_ERROR;
+	_localColorTable = lctPresent;
 
-	const ColorTable* colorTable = currentColorTable();
-	assert(colorTable);
+	if (currentPalette() == nullptr)
+		return DECODE_ERROR;
+
+	// Root codes are all values representable on min. code size bits, regardless of color table size
+	std::uint16_t codeTableSize = 1 << minCodeSize;
 
 	// We need to increase min. code size because code table would not fit 2 more records
 	minCodeSize++;
 
-	DataBuffer decodedData;
-	LzwDecoder lzwDecoder(minCodeSize, colorTable->size(), compressedData);
-	if (!lzwDecoder.decode(decodedData))
-		return false;
-
-	print("LZW decompressed data with size ", decodedData.getSize());
-
-	_image = imageFromIndexBuffer(imageWidth, imageHeight, interlaced, decodedData);
+	_imageDescriptor = descriptor;
+	_rowsEmitted = 0;
+	if (!startFrame())
+		return DECODE_ERROR;
+
+	// Size of decoded data is known in advance, so it is decoded right into buffer of this size
+	// Data sub-blocks are then passed to LZW decoder right from the input as they come
+	// LZW decoder is finished once the rows needed by the canvas are decoded, the rest of data is skipped
+	// Streamed rows are not kept, so only the window of rows is decoded at once
+	// With the expansion limit, memory for rows is not taken before their data come either
+	std::size_t windowRows = _frameRows;
+	if (_streamRows || _limits.maxExpansionRatio != 0)
+		windowRows = std::min<std::size_t>(windowRows, std::max<std::size_t>(STREAM_WINDOW_SIZE / std::max<std::size_t>(descriptor.width, 1), 1));
+
+	_indexBuffer.resize(descriptor.width * windowRows);
+	// Decoder of the previous image is reused, so its code table is not allocated again
+	if (_spareLzwDecoder != nullptr)
+	{
+		_lzwDecoder = std::move(_spareLzwDecoder);
+		_lzwDecoder->restart(minCodeSize, codeTableSize);
+	}
+	else
+		_lzwDecoder = std::make_unique<LzwDecoder>(minCodeSize, codeTableSize);
 
-	popColorTable();
-	return true;
+	_lzwDecoder->start(_indexBuffer.getRawData(), _indexBuffer.getSize());
+	_windowFirstRow = 0;
+	_windowRows = windowRows;
+	return DECODE_OK;
 }
 
-bool GifDecoder::decodeGraphicBlock()
+DecodeResult GifDecoder::decodeGraphicBlock()
 {
 	// Graphic Control Extension
 	if (!enoughData(1))
-		return false;
+		return DECODE_NEED_DATA;
 
-	std::uint8_t blockSize = _gifBuffer->read(_decodePos++, 1).getInt<std::uint8_t>();
+	std::uint8_t blockSize = _gifData.read<std::uint8_t>(_decodePos++);
 
 	// +1 for terminator
 	if (!enoughData(blockSize + 1))
-		return false;
+		return DECODE_NEED_DATA;
 
-	_decodePos += blockSize + 1;
+	// Packed fields: 3 bits reserved, 3 bits disposal method, 1 bit user input flag, 1 bit transparent color flag
+	// The control applies to the next image only
+	GraphicControl control;
+	if (blockSize >= 4)
+	{
+		// Values 4-7 are reserved, they are treated as no disposal
+		std::uint8_t disposal = _gifData.bits<std::uint8_t>(_decodePos, 2, 3);
+		control.disposal = disposal <= DISPOSAL_METHOD_PREVIOUS ? static_cast<DisposalMethod>(disposal) : DISPOSAL_METHOD_NONE;
+		control.transparent = _gifData.bits<bool>(_decodePos, 0, 1);
+		control.delay = _gifData.read<std::uint16_t>(_decodePos + 1);
+		control.transparentIndex = _gifData.read<std::uint8_t>(_decodePos + 3);
+	}
 
-	if (!enoughData(1))
-		return false;
+	print("Disposal method: ", static_cast<std::uint16_t>(control.disposal));
+	print("Delay: ", control.delay);
+	print("Transparent color index: ", control.transparent ? static_cast<std::int16_t>(control.transparentIndex) : -1);
 
-	std::uint8_t dataBlockCode = _gifBuffer->read(_decodePos++, 1).getInt<std::uint8_t>();
-	switch (dataBlockCode)
+	_graphicControl = control;
+	_decodePos += blockSize + 1;
+	return DECODE_OK;
+}
+
+/**
+ * Decodes the chain of data sub-blocks. Image data are passed to LZW decoder,
+ * sub-blocks of other blocks are skipped. Sub-blocks do not need to be complete,
+ * whatever part of sub-block is available is decoded.
+ */
+DecodeResult GifDecoder::decodeSubBlocks()
+{
+	if (_subBlockRemaining == 0)
 	{
-		// Image Descriptor identifier
-		case BLOCK_ID_IMAGE_DESCRIPTOR:
-			print("Image Descriptor Block");
-			if (!decodeTableBasedImage())
-				return false;
-			break;
-		// Extension identifier
-		case BLOCK_ID_EXTENSION:
+		if (!enoughData(1))
+			return DECODE_NEED_DATA;
+
+		_subBlockRemaining = _gifData.read<std::uint8_t>(_decodePos++);
+
+		// Terminator
+		if (_subBlockRemaining == 0)
 		{
-			if (!enoughData(1))
-				return false;
+			_state = DECODER_STATE_DATA_BLOCK;
 
-			dataBlockCode = _gifBuffer->read(_decodePos++, 1).getInt<std::uint8_t>();
-			// Plain Text Extension
-			if (dataBlockCode != EXTENSION_ID_PLAIN_TEXT)
-				return false;
+			// Pixels which are not covered by the data are filled with background, so the frame
+			// with just few bytes of data can still be the largest one
+			if (_imageSubBlocks)
+			{
+				const ImageDescriptor& descriptor = _info.frames.back().descriptor;
+				if (expansionExceeded(static_cast<std::uint64_t>(descriptor.width) * descriptor.height))
+					return limitExceeded();
+			}
 
-			assert(false && "Plain Text Extension");
-			break;
+			if (_imageSubBlocks && !_probeOnly && !finishImage())
+				return DECODE_ERROR;
 		}
-		default:
-			return false;
+		else if (timeExceeded())
+			return limitExceeded();
+
+		return DECODE_OK;
+	}
+
+	std::size_t amount = std::min(_subBlockRemaining, _gifData.getSize() - _decodePos);
+	if (amount == 0)
+		return DECODE_NEED_DATA;
+
+	if (_imageSubBlocks)
+	{
+		_info.frames.back().compressedSize += amount;
+		_info.compressedSize += amount;
 	}
 
+	if (_lzwDecoder && !_lzwDecoder->isFinished())
+	{
+		if (!_lzwDecoder->feed(_gifData.getData() + _decodePos, amount) || !emitDecodedRows())
+			return DECODE_ERROR;
+
+		// Expansion is checked after every sub-block, so small data cannot make the whole huge frame decoded
+		if (expansionExceeded(_windowFirstRow * _imageDescriptor.width + _lzwDecoder->getDecodedSize()))
+			return limitExceeded();
+	}
+
+	_decodePos += amount;
+	_subBlockRemaining -= amount;
+	return DECODE_OK;
+}
+
+bool GifDecoder::finishImage()
+{
+	print("LZW decompressed data with size ", _lzwDecoder->getDecodedSize());
+
+	// Rows which were not decoded are filled with background
+	_lzwDecoder->finish(_backgroundIndex);
+	releaseLzwDecoder();
+	emitRows(_windowFirstRow + _windowRows);
+
+	// Including the rows after the last window
+	while (_imageDescriptor.width > 0 && _rowsEmitted < _frameRows)
+	{
+		moveWindow();
+		std::fill(_indexBuffer.getRawData(), _indexBuffer.getRawData() + _windowRows * _imageDescriptor.width, _backgroundIndex);
+		emitRows(_windowFirstRow + _windowRows);
+	}
+
+	completeFrame();
 	return true;
 }
 
-const GifDecoder::ColorTable* GifDecoder::currentColorTable() const
+/**
+ * Finishes the frame whose rows are all composited into the canvas.
+ */
+void GifDecoder::completeFrame()
 {
-	if (_colorTableStack.empty())
-		return nullptr;
+	// Disposal of this frame is done right before the next frame is drawn
+	_previousFrame = _imageDescriptor;
+	_previousDisposal = _graphicControl.disposal;
+	_graphicControl = GraphicControl();
+
+	// Streamed canvas has no image, only the rest of its rows
+	releaseImage();
+	if (_streamRows)
+		streamBackgroundRows(_canvasHeight);
+	else if (_imageCallback)
+	{
+		// Canvas is only lent to the image for the callback and taken back, so it is never copied
+		std::unique_ptr<Image> image = createImage();
+		_imageCallback(*image);
+		if (_indexedCanvas)
+			_indexCanvas = image->releaseIndices();
+		else
+			_canvas = image->releaseColors();
+		_spareImage = std::move(image);
+	}
 
-	return &(_colorTableStack.top());
+	_localColorTable = false;
 }
 
-bool GifDecoder::newColorTable(const DataBuffer& colorTableBuffer)
+/**
+ * Reports rows decoded so far. If the frame is decoded in windows of rows and
+ * the window is full, the window is moved to the following rows and decoding
+ * continues with the coded data which are left.
+ *
+ * @return False for malformed coded data, otherwise true.
+ */
+bool GifDecoder::emitDecodedRows()
 {
-	if (colorTableBuffer.getSize() % 3 != 0)
-		return false;
+	if (_imageDescriptor.width == 0)
+		return true;
 
-	ColorTable colorTable;
-	for (std::uint16_t i = 0; i < colorTableBuffer.getSize(); i += 3)
+	emitRows(_windowFirstRow + _lzwDecoder->getDecodedSize() / _imageDescriptor.width);
+	while (_rowsEmitted == _windowFirstRow + _windowRows && _rowsEmitted < _frameRows)
 	{
-		Color color;
-		color.red = colorTableBuffer.read(i, 1).getInt<std::uint8_t>();
-		color.green = colorTableBuffer.read(i + 1, 1).getInt<std::uint8_t>();
-		color.blue = colorTableBuffer.read(i + 2, 1).getInt<std::uint8_t>();
-		colorTable.push_back(color);
+		moveWindow();
+		if (!_lzwDecoder->resume(_indexBuffer.getRawData(), _windowRows * _imageDescriptor.width))
+			return false;
+
+		emitRows(_windowFirstRow + _lzwDecoder->getDecodedSize() / _imageDescriptor.width);
 	}
 
-	_colorTableStack.push(std::move(colorTable));
 	return true;
 }
 
-void GifDecoder::popColorTable()
+/**
+ * Moves the window of decoded rows right after the rows which were already emitted.
+ */
+void GifDecoder::moveWindow()
+{
+	std::size_t windowRows = _indexBuffer.getSize() / _imageDescriptor.width;
+
+	_windowFirstRow = _rowsEmitted;
+	_windowRows = std::min<std::size_t>(windowRows, _frameRows - _windowFirstRow);
+}
+
+/**
+ * Composites decoded rows of current image into the canvas and reports them to the row callback.
+ *
+ * @param rowCount The number of rows of the image which are decoded so far.
+ */
+void GifDecoder::emitRows(std::size_t rowCount)
+{
+	if (_imageDescriptor.width == 0)
+		return;
+
+	const Palette* palette = currentPalette();
+	for (; _rowsEmitted < rowCount; ++_rowsEmitted)
+	{
+		if (_imageDescriptor.interlaced)
+			reportPasses();
+
+		std::uint16_t row = _imageDescriptor.interlaced ? _rowMap[_rowsEmitted] : static_cast<std::uint16_t>(_rowsEmitted);
+
+		const std::uint8_t* indices = _indexBuffer.getRawData() + (_rowsEmitted - _windowFirstRow) * _imageDescriptor.width;
+		if (_streamRows)
+			streamRow(row, indices, *palette);
+		else
+			compositeRow(row, indices, *palette);
+
+		if (_rowCallback)
+			_rowCallback(_imageDescriptor, row, indices, *palette);
+	}
+
+	if (_imageDescriptor.interlaced)
+		reportPasses();
+}
+
+/**
+ * Reports passes of interlaced image which are complete with the rows emitted so far.
+ * Passes of small images can be empty, they are complete together with the previous one.
+ */
+void GifDecoder::reportPasses()
+{
+	for (; _passesReported < INTERLACE_PASS_COUNT && _rowsEmitted >= _passEnds[_passesReported]; ++_passesReported)
+	{
+		if (_passCallback)
+			_passCallback(_imageDescriptor, _passesReported);
+	}
+}
+
+/**
+ * Maps rows of interlaced image in the order in which they are stored in GIF
+ * to rows of the image, so that decoded rows go right to their place.
+ * End of every pass in the stored order is kept as well.
+ */
+void GifDecoder::mapRows()
 {
-	if (_colorTableStack.empty())
+	_rowMap.clear();
+	_passesReported = 0;
+	if (!_imageDescriptor.interlaced)
 		return;
 
-	_colorTableStack.pop();
+	_rowMap.reserve(_imageDescriptor.height);
+	for (std::uint8_t pass = 0; pass < INTERLACE_PASS_COUNT; ++pass)
+	{
+		for (std::size_t row = INTERLACE_PASS_START[pass]; row < _imageDescriptor.height; row += INTERLACE_PASS_STEP[pass])
+			_rowMap.push_back(static_cast<std::uint16_t>(row));
+		_passEnds[pass] = _rowMap.size();
+	}
+}
+
+/**
+ * Places the canvas into the logical screen. Canvas covers the whole logical screen
+ * or only the region of it if the region is set.
+ *
+ * @param firstFrame The first frame of GIF.
+ *
+ * @return False if the region is outside of the logical screen, the canvas is too large or exceeds the limit, otherwise true.
+ */
+bool GifDecoder::placeCanvas(const ImageDescriptor& firstFrame)
+{
+	// Canvas of size 0 is enlarged to fit the first frame, which cannot reach past the largest size of the image
+	std::uint32_t width = _info.width ? _info.width : static_cast<std::uint32_t>(firstFrame.x) + firstFrame.width;
+	std::uint32_t height = _info.height ? _info.height : static_cast<std::uint32_t>(firstFrame.y) + firstFrame.height;
+	if (width > UINT16_MAX || height > UINT16_MAX)
+		return false;
+
+	_canvasX = _canvasY = 0;
+	if (_region.width > 0 && _region.height > 0)
+	{
+		_canvasX = static_cast<std::uint16_t>(std::min<std::uint32_t>(_region.x, width));
+		_canvasY = static_cast<std::uint16_t>(std::min<std::uint32_t>(_region.y, height));
+		width = std::min<std::uint32_t>(_region.width, width - _canvasX);
+		height = std::min<std::uint32_t>(_region.height, height - _canvasY);
+	}
+
+	_canvasWidth = static_cast<std::uint16_t>(width);
+	_canvasHeight = static_cast<std::uint16_t>(height);
+	if (exceedsLimit(_limits.maxPixels, static_cast<std::uint64_t>(width) * height))
+	{
+		limitExceeded();
+		return false;
+	}
+
+	return (_region.width == 0 || _region.height == 0) || (_canvasWidth > 0 && _canvasHeight > 0);
+}
+
+/**
+ * Clips the area of the logical screen to the canvas.
+ *
+ * @param rect The area of the logical screen.
+ *
+ * @return The area in coordinates of the canvas, empty if it is outside of the canvas.
+ */
+GifDecoder::ImageDescriptor GifDecoder::canvasArea(const ImageDescriptor& rect) const
+{
+	std::size_t startX = std::max(rect.x, _canvasX);
+	std::size_t startY = std::max(rect.y, _canvasY);
+	std::size_t endX = std::min<std::size_t>(rect.x + rect.width, _canvasX + _canvasWidth);
+	std::size_t endY = std::min<std::size_t>(rect.y + rect.height, _canvasY + _canvasHeight);
+
+	ImageDescriptor area;
+	if (startX < endX && startY < endY)
+	{
+		area.x = static_cast<std::uint16_t>(startX - _canvasX);
+		area.y = static_cast<std::uint16_t>(startY - _canvasY);
+		area.width = static_cast<std::uint16_t>(endX - startX);
+		area.height = static_cast<std::uint16_t>(endY - startY);
+	}
+
+	return area;
+}
+
+/**
+ * Returns the number of rows of the frame in the order in which they are stored
+ * in GIF, which have to be decoded to get all rows of the frame inside of the canvas.
+ * Rows after them do not need to be decoded.
+ *
+ * @param descriptor The frame.
+ *
+ * @return The number of rows to decode.
+ */
+std::size_t GifDecoder::neededRows(const ImageDescriptor& descriptor) const
+{
+	ImageDescriptor area = canvasArea(descriptor);
+	if (area.height == 0)
+		return 0;
+
+	// Rows of the frame which are inside of the canvas
+	std::size_t startRow = static_cast<std::size_t>(_canvasY) + area.y - descriptor.y;
+	std::size_t endRow = startRow + area.height;
+	if (!descriptor.interlaced)
+		return endRow;
+
+	// The last needed row is in the last pass which has any row inside of the canvas
+	std::size_t passEnds[INTERLACE_PASS_COUNT];
+	for (std::uint8_t pass = 0; pass < INTERLACE_PASS_COUNT; ++pass)
+	{
+		std::size_t passRows = descriptor.height > INTERLACE_PASS_START[pass] ? (descriptor.height - INTERLACE_PASS_START[pass] - 1) / INTERLACE_PASS_STEP[pass] + 1 : 0;
+		passEnds[pass] = (pass > 0 ? passEnds[pass - 1] : 0) + passRows;
+	}
+
+	for (std::uint8_t pass = INTERLACE_PASS_COUNT; pass-- > 0;)
+	{
+		std::size_t passStart = pass > 0 ? passEnds[pass - 1] : 0;
+		if (endRow <= INTERLACE_PASS_START[pass])
+			continue;
+
+		// Index of the last row of this pass before the end row
+		std::size_t lastIndex = (endRow - 1 - INTERLACE_PASS_START[pass]) / INTERLACE_PASS_STEP[pass];
+		if (INTERLACE_PASS_START[pass] + lastIndex * INTERLACE_PASS_STEP[pass] >= startRow)
+			return passStart + lastIndex + 1;
+	}
+
+	return 0;
 }
 
-std::unique_ptr<Image> GifDecoder::imageFromIndexBuffer(std::uint16_t width, std::uint16_t height, bool interlaced, const DataBuffer& indexBuffer)
+/**
+ * Prepares the canvas for the frame which is about to be decoded. Canvas is created
+ * with the first frame, disposal of the previous frame is done and the area
+ * of this frame is saved if it needs to be restored after this frame.
+ *
+ * @return False if the canvas cannot be placed, otherwise true.
+ */
+bool GifDecoder::startFrame()
 {
-	const ColorTable* colorTable = currentColorTable();
-	if (colorTable == nullptr)
-		return nullptr;
+	if (_canvas.empty() && _indexCanvas.empty() && !placeCanvas(_imageDescriptor))
+		return false;
 
-	std::vector<Image::Pixel> pixels;
-	pixels.resize(width * height);
-	std::uint64_t pos = 0;
+	mapRows();
+	_frameArea = canvasArea(_imageDescriptor);
+	_frameRows = neededRows(_imageDescriptor);
 
-	if (!interlaced)
+	if (_canvas.empty() && _indexCanvas.empty())
 	{
-		loadPixels(pixels, width, height, 0, 1, pos, indexBuffer);
+		std::size_t canvasSize = static_cast<std::size_t>(_canvasWidth) * _canvasHeight;
+
+		// Only single row of streamed canvas exists, rows above the frame are just background
+		if (_streamRows)
+		{
+			std::size_t frameTop = _imageDescriptor.y > _canvasY ? _imageDescriptor.y - _canvasY : 0;
+			_canvasRow.assign(_canvasWidth, _backgroundColor);
+			streamBackgroundRows(std::min<std::size_t>(frameTop, _canvasHeight));
+			return true;
+		}
+
+		// Canvas holds only indices as long as frames use global color table which also contains the background
+		_indexedCanvas = _info.colorTableSize > 0 && _backgroundIndex < _info.colorTableSize && !_localColorTable;
+		if (_indexedCanvas)
+		{
+			_canvasPalette = _globalPalette;
+			_indexCanvas.assign(canvasSize, _backgroundIndex);
+		}
+		else
+			_canvas.assign(canvasSize, _backgroundColor);
 	}
 	else
 	{
-		// Every 8th row starting with row 0
-		loadPixels(pixels, width, height, 0, 8, pos, indexBuffer);
-		// Every 8th row starting with row 4
-		loadPixels(pixels, width, height, 4, 8, pos, indexBuffer);
-		// Every 4th row starting with row 2
-		loadPixels(pixels, width, height, 2, 4, pos, indexBuffer);
-		// Every 2nd row starting with row 1
-		loadPixels(pixels, width, height, 1, 2, pos, indexBuffer);
+		if (_indexedCanvas && _localColorTable)
+			expandCanvas();
+
+		if (_previousDisposal == DISPOSAL_METHOD_BACKGROUND)
+			fillCanvas(_previousFrame);
+		else if (_previousDisposal == DISPOSAL_METHOD_PREVIOUS)
+			restoreCanvas(_previousFrame);
 	}
 
-	return std::make_unique<Image>(width, height, pixels);
+	// Only the area covered by this frame is saved, not the whole canvas
+	if (_graphicControl.disposal == DISPOSAL_METHOD_PREVIOUS)
+		copyCanvas(_imageDescriptor);
+
+	return true;
 }
 
-void GifDecoder::loadPixels(std::vector<Image::Pixel>& pixels, std::uint16_t width, std::uint16_t height, std::uint16_t startRow,
-		std::uint16_t rowStep, std::uint64_t& readPos, const DataBuffer& indexBuffer)
+/**
+ * Draws the row of current image into the canvas. Transparent pixels
+ * and pixels outside of the canvas are skipped.
+ *
+ * @param row The row of the image.
+ * @param indices Color indices of the row.
+ * @param palette The color table of the image.
+ */
+void GifDecoder::compositeRow(std::uint16_t row, const std::uint8_t* indices, const Palette& palette)
 {
-	for (std::uint16_t y = startRow; y < height; y += rowStep)
+	std::size_t y = static_cast<std::size_t>(_imageDescriptor.y) + row;
+	std::size_t frameTop = static_cast<std::size_t>(_canvasY) + _frameArea.y;
+	if (y < frameTop || y >= frameTop + _frameArea.height)
+		return;
+
+	y -= _canvasY;
+	indices += _canvasX + _frameArea.x - _imageDescriptor.x;
+	std::size_t width = _frameArea.width;
+	if (_indexedCanvas)
 	{
-		for (std::uint16_t x = 0; x < width; ++x)
+		std::uint8_t* canvasRow = _indexCanvas.data() + y * _canvasWidth + _frameArea.x;
+		for (std::size_t x = 0; x < width; ++x)
 		{
-			Image::Pixel pixel;
-			pixel.coord.x = x;
-			pixel.coord.y = y;
-			pixel.color = currentColorTable()->at(indexBuffer.getBuffer()[readPos++]);
-			pixels[y * width + x] = pixel;
+			if (!_graphicControl.transparent || indices[x] != _graphicControl.transparentIndex)
+				canvasRow[x] = indices[x];
 		}
+
+		return;
+	}
+
+	Color* canvasRow = _canvas.data() + y * _canvasWidth + _frameArea.x;
+	for (std::size_t x = 0; x < width; ++x)
+	{
+		std::uint8_t index = indices[x];
+		if (_graphicControl.transparent && index == _graphicControl.transparentIndex)
+			continue;
+
+		canvasRow[x] = palette[index];
+	}
+}
+
+/**
+ * Composites the row of current image with the background and reports it as the row
+ * of the canvas to the canvas row callback. Rows of the frame come from top to bottom,
+ * so all rows of the canvas above it were already reported.
+ *
+ * @param row The row of the image.
+ * @param indices Color indices of the row.
+ * @param palette The color table of the image.
+ */
+void GifDecoder::streamRow(std::uint16_t row, const std::uint8_t* indices, const Palette& palette)
+{
+	std::size_t y = static_cast<std::size_t>(_imageDescriptor.y) + row;
+	if (y < _canvasY || y >= _canvasY + _canvasHeight)
+		return;
+
+	y -= _canvasY;
+	std::fill(_canvasRow.begin(), _canvasRow.end(), _backgroundColor);
+
+	// Frame can be outside of the canvas, then the whole row is background
+	std::size_t firstIndex = _frameArea.width > 0 ? _canvasX + _frameArea.x - _imageDescriptor.x : 0;
+	for (std::size_t x = 0; x < _frameArea.width; ++x)
+	{
+		std::uint8_t index = indices[firstIndex + x];
+		if (_graphicControl.transparent && index == _graphicControl.transparentIndex)
+			continue;
+
+		_canvasRow[_frameArea.x + x] = palette[index];
 	}
+
+	if (_canvasRowCallback)
+		_canvasRowCallback(static_cast<std::uint16_t>(y), _canvasRow);
+	_canvasRowsEmitted = y + 1;
+}
+
+/**
+ * Reports rows of the canvas which are not covered by the frame up to the given row.
+ *
+ * @param endRow The row of the canvas right after the last row to report.
+ */
+void GifDecoder::streamBackgroundRows(std::size_t endRow)
+{
+	std::fill(_canvasRow.begin(), _canvasRow.end(), _backgroundColor);
+	for (; _canvasRowsEmitted < endRow; ++_canvasRowsEmitted)
+	{
+		if (_canvasRowCallback)
+			_canvasRowCallback(static_cast<std::uint16_t>(_canvasRowsEmitted), _canvasRow);
+	}
+}
+
+/**
+ * Fills the area of the canvas with the background.
+ *
+ * @param rect The area of the logical screen to fill, it is clipped to the canvas.
+ */
+void GifDecoder::fillCanvas(const ImageDescriptor& rect)
+{
+	ImageDescriptor area = canvasArea(rect);
+	if (_indexedCanvas)
+		fillArea(_indexCanvas, _canvasWidth, _canvasHeight, area, _backgroundIndex);
+	else
+		fillArea(_canvas, _canvasWidth, _canvasHeight, area, _backgroundColor);
+}
+
+/**
+ * Saves the area of the canvas, so it can be restored by restoreCanvas().
+ *
+ * @param rect The area of the logical screen to save, it is clipped to the canvas.
+ */
+void GifDecoder::copyCanvas(const ImageDescriptor& rect)
+{
+	ImageDescriptor area = canvasArea(rect);
+	if (_indexedCanvas)
+		copyArea(_indexCanvas, _canvasWidth, _canvasHeight, area, _previousIndices);
+	else
+		copyArea(_canvas, _canvasWidth, _canvasHeight, area, _previousCanvas);
+}
+
+/**
+ * Restores the area of the canvas saved by copyCanvas().
+ *
+ * @param rect The area of the logical screen to restore, it is clipped to the canvas.
+ */
+void GifDecoder::restoreCanvas(const ImageDescriptor& rect)
+{
+	ImageDescriptor area = canvasArea(rect);
+	if (_indexedCanvas)
+		restoreArea(_indexCanvas, _canvasWidth, _canvasHeight, area, _previousIndices);
+	else
+		restoreArea(_canvas, _canvasWidth, _canvasHeight, area, _previousCanvas);
+}
+
+/**
+ * Turns the canvas of indices into the canvas of colors. This happens once the frame
+ * with its own color table comes, which cannot be described by the same palette.
+ */
+void GifDecoder::expandCanvas()
+{
+	_canvas.resize(_indexCanvas.size());
+	std::transform(_indexCanvas.begin(), _indexCanvas.end(), _canvas.begin(), [this](std::uint8_t index) { return _canvasPalette[index]; });
+	_previousCanvas.resize(_previousIndices.size());
+	std::transform(_previousIndices.begin(), _previousIndices.end(), _previousCanvas.begin(), [this](std::uint8_t index) { return _canvasPalette[index]; });
+
+	_indexedCanvas = false;
+	_canvasPalette.clear();
+	ArenaVector<std::uint8_t>(_arena).swap(_indexCanvas);
+	_previousIndices.clear();
+}
+
+/**
+ * Creates the image with current state of the canvas, which is moved into the image.
+ * Canvas of indices gives indexed image with the global color table as its palette.
+ *
+ * @return Image of the canvas.
+ */
+std::unique_ptr<Image> GifDecoder::createImage()
+{
+	if (_indexedCanvas)
+		return reuseImage(Image(_canvasWidth, _canvasHeight, std::move(_indexCanvas), _canvasPalette));
+
+	return reuseImage(Image(_canvasWidth, _canvasHeight, std::move(_canvas)));
+}
+
+/**
+ * Moves the image into the object of the released image if there is one,
+ * so that the object is not allocated for every image.
+ *
+ * @param image The image.
+ *
+ * @return The image object.
+ */
+std::unique_ptr<Image> GifDecoder::reuseImage(Image&& image)
+{
+	if (_spareImage == nullptr)
+		return std::make_unique<Image>(std::move(image));
+
+	std::unique_ptr<Image> result = std::move(_spareImage);
+	*result = std::move(image);
+	return result;
+}
+
+/**
+ * Releases the current image, its object is kept for the next image.
+ */
+void GifDecoder::releaseImage()
+{
+	if (_image != nullptr)
+		_spareImage = std::move(_image);
+}
+
+/**
+ * Releases LZW decoder of the finished image, the decoder is kept for the next image.
+ */
+void GifDecoder::releaseLzwDecoder()
+{
+	if (_lzwDecoder != nullptr)
+		_spareLzwDecoder = std::move(_lzwDecoder);
+}
+
+/**
+ * Returns the color table which applies to current image. Local color table
+ * takes precedence over the global one.
+ *
+ * @return The color table or nullptr if there is none.
+ */
+const Palette* GifDecoder::currentPalette() const
+{
+	if (_localColorTable)
+		return &_localPalette;
+
+	if (!_globalPalette.isEmpty())
+		return &_globalPalette;
+
+	return nullptr;
 }
@@ -1,12 +1,18 @@
 #ifndef GIF_DECODER_H
 #define GIF_DECODER_H
 
+#include <chrono>
 #include <cstdio>
+#include <functional>
 #include <memory>
-#include <stack>
 
+#include "arena.h"
 #include "data_buffer.h"
 #include "image.h"
+#include "input_source.h"
+#include "lzw_decoder.h"
+#include "palette.h"
+#include "thread_pool.h"
 #include "utils.h"
 
 enum BlockId
@@ -24,43 +30,262 @@ enum ExtensionId
 	EXTENSION_ID_APPLICATION      = 0xFF
 };
 
+enum DisposalMethod
+{
+	DISPOSAL_METHOD_NONE          = 0,
+	DISPOSAL_METHOD_KEEP          = 1,
+	DISPOSAL_METHOD_BACKGROUND    = 2,
+	DISPOSAL_METHOD_PREVIOUS      = 3
+};
+
+// Interlaced image is stored in four passes
+const std::uint8_t INTERLACE_PASS_COUNT = 4;
+
+enum DecoderState
+{
+	DECODER_STATE_SIGNATURE,
+	DECODER_STATE_LOGICAL_SCREEN_DESCRIPTOR,
+	DECODER_STATE_DATA_BLOCK,
+	DECODER_STATE_SUB_BLOCKS,
+	DECODER_STATE_TERMINATED,
+	DECODER_STATE_ERROR
+};
+
+enum DecodeResult
+{
+	DECODE_OK,
+	DECODE_NEED_DATA,
+	DECODE_ERROR
+};
+
+/**
+ * Resumable GIF decoder. The data can be passed in arbitrary-sized chunks using feed()
+ * and rows and images are reported through callbacks as soon as they are decoded.
+ * Only the start of the block which is split between two chunks is kept
+ * between the calls, everything else is decoded right from the chunks.
+ * Decoder can be reused for more files, see setFile(). GIF which is already in memory
+ * is decoded right from there, see setData().
+ */
 class GifDecoder
 {
 public:
-	using ColorTable = std::vector<Color>;
+	struct ImageDescriptor
+	{
+		ImageDescriptor() : x(0), y(0), width(0), height(0), interlaced(false) {}
+
+		std::uint16_t x;
+		std::uint16_t y;
+		std::uint16_t width;
+		std::uint16_t height;
+		bool interlaced;
+	};
+
+	struct GraphicControl
+	{
+		GraphicControl() : disposal(DISPOSAL_METHOD_NONE), delay(0), transparent(false), transparentIndex(0) {}
 
-	GifDecoder() = delete;
+		DisposalMethod disposal;
+		std::uint16_t delay;
+		bool transparent;
+		std::uint8_t transparentIndex;
+	};
+
+	struct FrameInfo
+	{
+		FrameInfo() : descriptor(), control(), colorTableSize(0), compressedSize(0), colorTableOffset(0), dataOffset(0), minCodeSize(0) {}
+
+		ImageDescriptor descriptor;
+		GraphicControl control;
+		std::uint16_t colorTableSize;
+		std::uint64_t compressedSize;
+		std::uint64_t colorTableOffset;
+		std::uint64_t dataOffset;
+		std::uint8_t minCodeSize;
+	};
+
+	/**
+	 * Metadata of the whole GIF which are collected from the block structure
+	 * without decoding the image data.
+	 */
+	struct GifInfo
+	{
+		GifInfo() : width(0), height(0), colorTableSize(0), backgroundIndex(0), compressedSize(0), pixelCount(0), colorTableOffset(0), frames() {}
+
+		std::uint16_t width;
+		std::uint16_t height;
+		std::uint16_t colorTableSize;
+		std::uint8_t backgroundIndex;
+		std::uint64_t compressedSize;
+		std::uint64_t pixelCount;
+		std::uint64_t colorTableOffset;
+		std::vector<FrameInfo> frames;
+	};
+
+	/**
+	 * Limits of resources which decoding of untrusted GIF can take. Limits are checked
+	 * from the block structure before anything is allocated and while the image data
+	 * are decoded. Zero means no limit.
+	 */
+	struct Limits
+	{
+		Limits() : maxPixels(0), maxFrames(0), maxDecodedPixels(0), maxTime(0), maxExpansionRatio(0) {}
+
+		std::uint64_t maxPixels; // Pixels of the canvas and of every frame
+		std::uint32_t maxFrames;
+		std::uint64_t maxDecodedPixels; // Pixels of all frames together
+		std::uint32_t maxTime; // Milliseconds since reset() or decode()
+		std::uint32_t maxExpansionRatio; // Pixels of the frame per byte of its LZW data
+	};
+
+	using RowCallback = std::function<void(const ImageDescriptor& descriptor, std::uint16_t row, const std::uint8_t* indices, const Palette& palette)>;
+	using ImageCallback = std::function<void(const Image& image)>;
+	using PassCallback = std::function<void(const ImageDescriptor& descriptor, std::uint8_t pass)>;
+	using CanvasRowCallback = std::function<void(std::uint16_t row, const ArenaVector<Color>& colors)>;
+
+	GifDecoder();
 	GifDecoder(FILE *gifFile);
 	~GifDecoder();
 
 	bool decode();
+	bool probe();
+
+	void reset();
+	bool feed(const std::uint8_t* data, std::size_t size);
+	bool finish();
+	bool isFinished() const;
+
+	void setFile(FILE *gifFile);
+	void setData(const DataView& gifData);
+	void setProbeOnly(bool probeOnly);
+	void setThreadCount(std::size_t threadCount);
+	void setStreaming(bool streaming);
+	void setRegion(const ImageDescriptor& region);
+	void setLimits(const Limits& limits);
+	void setArena(Arena* arena);
+	void setRowCallback(const RowCallback& callback);
+	void setImageCallback(const ImageCallback& callback);
+	void setPassCallback(const PassCallback& callback);
+	void setCanvasRowCallback(const CanvasRowCallback& callback);
 
 	const Image* getImage() const;
+	const GifInfo& getInfo() const;
+	bool isLimitExceeded() const;
+	std::uint16_t getCanvasWidth() const;
+	std::uint16_t getCanvasHeight() const;
 
 protected:
+	bool decodeFile();
+	bool openInput(bool mappedOnly);
+	bool probeData(const DataView& gifData);
+	bool decodeStreaming(const DataView& gifData);
+	bool decodeParallel(const DataView& gifData);
+	bool decodeFrame(const DataView& gifData, const FrameInfo& frameInfo, DataBuffer& indexBuffer) const;
+	bool decodeFrameSegments(const DataView& gifData, const FrameInfo& frameInfo, DataBuffer& indexBuffer, ThreadPool& threadPool);
+	bool compositeFrame(const DataView& gifData, const FrameInfo& frameInfo, DataBuffer& indexBuffer);
+
+	void resetState();
+	bool parse(const DataView& data, std::uint64_t offset);
+	DecodeResult decodeNext();
+
 	bool enoughData(std::size_t amount);
-	bool nextDataBlock();
+	bool timeExceeded() const;
+	bool expansionExceeded(std::uint64_t pixels) const;
+	DecodeResult limitExceeded();
 
-	bool decodeSignature();
-	bool decodeLogicalScreenDescriptor();
-	bool decodeDataBlock();
-	bool decodeTableBasedImage();
-	bool decodeGraphicBlock();
+	DecodeResult decodeSignature();
+	DecodeResult decodeLogicalScreenDescriptor();
+	DecodeResult decodeDataBlock();
+	DecodeResult decodeTableBasedImage();
+	DecodeResult decodeGraphicBlock();
+	DecodeResult decodeSubBlocks();
+	bool finishImage();
+	void completeFrame();
+	bool emitDecodedRows();
+	void emitRows(std::size_t rowCount);
+	void reportPasses();
+	void moveWindow();
 
-	const ColorTable* currentColorTable() const;
-	bool newColorTable(const DataBuffer& colorTableBuffer);
-	void popColorTable();
+	bool placeCanvas(const ImageDescriptor& firstFrame);
+	ImageDescriptor canvasArea(const ImageDescriptor& rect) const;
+	std::size_t neededRows(const ImageDescriptor& descriptor) const;
+	void mapRows();
+	bool startFrame();
+	void compositeRow(std::uint16_t row, const std::uint8_t* indices, const Palette& palette);
+	void streamRow(std::uint16_t row, const std::uint8_t* indices, const Palette& palette);
+	void streamBackgroundRows(std::size_t endRow);
+	void fillCanvas(const ImageDescriptor& rect);
+	void copyCanvas(const ImageDescriptor& rect);
+	void restoreCanvas(const ImageDescriptor& rect);
+	void expandCanvas();
+	std::unique_ptr<Image> createImage();
+	std::unique_ptr<Image> reuseImage(Image&& image);
+	void releaseImage();
+	void releaseLzwDecoder();
 
-	std::unique_ptr<Image> imageFromIndexBuffer(std::uint16_t width, std::uint16_t height, bool interlaced, const DataBuffer& indexBuffer);
-	void loadPixels(std::vector<Image::Pixel>& pixels, std::uint16_t width, std::uint16_t height, std::uint16_t startRow,
-			std::uint16_t rowStep, std::uint64_t& readPos, const DataBuffer& indexBuffer);
+	const Palette* currentPalette() const;
 
 private:
 	FILE *_gifFile;
-	std::unique_ptr<DataBuffer> _gifBuffer;
+	DataView _gifMemory;
+	InputSource _input;
+	std::unique_ptr<ThreadPool> _threadPool;
+	DecoderState _state;
+	bool _probeOnly;
+	std::size_t _threadCount;
+	bool _streaming;
+	bool _streamRows;
+	ImageDescriptor _region;
+	Limits _limits;
+	bool _limitExceeded;
+	std::chrono::steady_clock::time_point _startTime;
+	Arena* _arena;
+	GifInfo _info;
+	DataBuffer _pending;
+	DataView _gifData;
+	std::uint64_t _gifDataOffset;
+	std::uint64_t _streamPos;
 	std::size_t _decodePos;
-	std::stack<ColorTable> _colorTableStack;
+	std::uint8_t _backgroundIndex;
+	Color _backgroundColor;
+	std::size_t _subBlockRemaining;
+	bool _imageSubBlocks;
+	ImageDescriptor _imageDescriptor;
+	GraphicControl _graphicControl;
+	bool _localColorTable;
+	DataBuffer _indexBuffer;
+	DataBuffer _codedData;
+	std::unique_ptr<LzwDecoder> _lzwDecoder;
+	std::unique_ptr<LzwDecoder> _spareLzwDecoder;
+	std::size_t _rowsEmitted;
+	std::size_t _windowFirstRow;
+	std::size_t _windowRows;
+	std::size_t _frameRows;
+	ImageDescriptor _frameArea;
+	std::vector<std::uint16_t> _rowMap;
+	std::size_t _passEnds[INTERLACE_PASS_COUNT];
+	std::uint8_t _passesReported;
+	Palette _globalPalette;
+	Palette _localPalette;
+	std::uint16_t _canvasX;
+	std::uint16_t _canvasY;
+	std::uint16_t _canvasWidth;
+	std::uint16_t _canvasHeight;
+	bool _indexedCanvas;
+	Palette _canvasPalette;
+	ArenaVector<std::uint8_t> _indexCanvas;
+	ArenaVector<Color> _canvas;
+	ImageDescriptor _previousFrame;
+	DisposalMethod _previousDisposal;
+	ArenaVector<std::uint8_t> _previousIndices;
+	ArenaVector<Color> _previousCanvas;
+	ArenaVector<Color> _canvasRow;
+	std::size_t _canvasRowsEmitted;
 	std::unique_ptr<Image> _image;
+	std::unique_ptr<Image> _spareImage;
+	RowCallback _rowCallback;
+	PassCallback _passCallback;
+	ImageCallback _imageCallback;
+	CanvasRowCallback _canvasRowCallback;
 };
 
 #endif
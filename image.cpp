@@ -1,70 +1,349 @@
+#include <algorithm>
+#include <utility>
 
-#include "data_buffer.h"
+#include "bmp_writer.h"
 #include "image.h"
+#include "image_scaler.h"
+#include "palette_expander.h"
 #include "utils.h"
 
-Image::Image(std::uint16_t width, std::uint16_t height, const std::vector<Pixel>& pixels) : _width(width), _height(height), _pixels(pixels)
+// Pixel data are written in chunks of about this size
+static const std::size_t BMP_OUTPUT_CHUNK_SIZE = 1024 * 1024;
+
+// Runs shorter than this are not worth encoding, it is also the shortest part in absolute mode
+static const std::size_t RLE8_MIN_RUN = 3;
+
+// Both encoded runs and absolute mode have 8-bit length
+static const std::size_t RLE8_MAX_RUN = 255;
+
+/**
+ * Creates the image from the plane of colors.
+ *
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param colors Colors of all pixels, row by row from the top.
+ */
+Image::Image(std::uint16_t width, std::uint16_t height, ArenaVector<Color>&& colors) :
+	_width(width), _height(height), _indices(), _indexed(false), _palette(), _colors(std::move(colors))
+{
+}
+
+/**
+ * Creates the indexed image from the plane of indices and the palette.
+ * The palette has 256 colors, so any index is valid.
+ *
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @param indices Palette indices of all pixels, row by row from the top.
+ * @param palette Colors of the palette.
+ */
+Image::Image(std::uint16_t width, std::uint16_t height, ArenaVector<std::uint8_t>&& indices, const Palette& palette) :
+	_width(width), _height(height), _indices(std::move(indices)), _indexed(true), _palette(palette), _colors()
+{
+}
+
+std::uint16_t Image::getWidth() const
+{
+	return _width;
+}
+
+std::uint16_t Image::getHeight() const
 {
+	return _height;
 }
 
-bool Image::saveBmp(FILE* outputFile) const
+bool Image::isIndexed() const
 {
-	DataBuffer outputBuffer;
+	return _indexed;
+}
+
+const ArenaVector<std::uint8_t>& Image::getIndices() const
+{
+	return _indices;
+}
+
+const Palette& Image::getPalette() const
+{
+	return _palette;
+}
+
+const ArenaVector<Color>& Image::getColors() const
+{
+	return _colors;
+}
 
-	// BITMAP File Header
-	outputBuffer.append(DataValue(std::string("BM"))); // Signature
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(0))); // Here will come the size of file in bytes, we don't know it yet
-	outputBuffer.append(DataValue(static_cast<std::uint16_t>(0))); // Reserved1
-	outputBuffer.append(DataValue(static_cast<std::uint16_t>(0))); // Reserved2
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(54))); // Offset to start pixel data
+/**
+ * Moves the plane of indices out of the image, which has no pixels afterwards.
+ *
+ * @return The plane of indices.
+ */
+ArenaVector<std::uint8_t> Image::releaseIndices()
+{
+	return std::move(_indices);
+}
 
-	// DIB Header
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(40))); // Size of this header
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(_width))); // Width
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(_height))); // Height
-	outputBuffer.append(DataValue(static_cast<std::uint16_t>(1))); // Must be 1
-	outputBuffer.append(DataValue(static_cast<std::uint16_t>(24))); // Depth
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(0))); // Compression method
-	//outputBuffer.append(DataValue(static_cast<std::uint32_t>(_pixels.size() * 3))); // Size of pixel data
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(0))); // Size of pixel data - can be zero for uncompressed BMP
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(0xB13))); // Horizontal pixel per meter
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(0xB13))); // Vertical pixel per meter
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(0))); // Color palette size
-	outputBuffer.append(DataValue(static_cast<std::uint32_t>(0))); // Can be ignored, just leave 0
+/**
+ * Moves the plane of colors out of the image, which has no pixels afterwards.
+ *
+ * @return The plane of colors.
+ */
+ArenaVector<Color> Image::releaseColors()
+{
+	return std::move(_colors);
+}
+
+/**
+ * Returns the color of single pixel.
+ *
+ * @param x The column of the pixel.
+ * @param y The row of the pixel.
+ *
+ * @return The color of the pixel.
+ */
+Color Image::getColor(std::uint16_t x, std::uint16_t y) const
+{
+	std::size_t pos = static_cast<std::size_t>(y) * _width + x;
+	return isIndexed() ? _palette[_indices[pos]] : _colors[pos];
+}
+
+/**
+ * Expands the row of the image into packed BGR or BGRA bytes. Alpha is always opaque.
+ *
+ * @param y The row to expand.
+ * @param output The buffer for width * bytesPerPixel bytes.
+ * @param bytesPerPixel 3 for BGR, 4 for BGRA.
+ */
+void Image::expandRow(std::uint16_t y, std::uint8_t* output, std::size_t bytesPerPixel) const
+{
+	std::size_t rowStart = static_cast<std::size_t>(y) * _width;
+	if (isIndexed())
+	{
+		if (bytesPerPixel == 4)
+			PaletteExpander::expandBgra(_indices.data() + rowStart, _width, _palette.getPacked(), output);
+		else
+			PaletteExpander::expandBgr(_indices.data() + rowStart, _width, _palette.getPacked(), output);
+		return;
+	}
+
+	for (std::size_t x = 0; x < _width; ++x, output += bytesPerPixel)
+	{
+		const Color& color = _colors[rowStart + x];
+		output[0] = color.blue;
+		output[1] = color.green;
+		output[2] = color.red;
+		if (bytesPerPixel == 4)
+			output[3] = 0xFF;
+	}
+}
+
+/**
+ * Downscales the image by box filter, see ImageScaler. Rows are passed
+ * to the scaler one by one, so the image is never expanded at once.
+ *
+ * @param width The width of the scaled image, at most the width of this image.
+ * @param height The height of the scaled image, at most the height of this image.
+ *
+ * @return The scaled image of colors.
+ */
+std::unique_ptr<Image> Image::scale(std::uint16_t width, std::uint16_t height) const
+{
+	ImageScaler scaler(_width, _height, width, height, getAllocator().getArena());
+	for (std::size_t y = 0; y < _height; ++y)
+	{
+		if (isIndexed())
+			scaler.addRow(_indices.data() + y * _width, _palette);
+		else
+			scaler.addRow(_colors.data() + y * _width);
+	}
+
+	return scaler.createImage();
+}
+
+/**
+ * Returns the allocator of the plane of the image.
+ *
+ * @return The allocator which takes memory from the same arena as the plane.
+ */
+ArenaAllocator<std::uint8_t> Image::getAllocator() const
+{
+	if (isIndexed())
+		return _indices.get_allocator();
+
+	return _colors.get_allocator();
+}
+
+/**
+ * Saves the image as BMP. 8-bit BMP is written only for indexed image, its palette
+ * is written as BMP color table and rows of indices are written directly or
+ * compressed by RLE8. Image of colors is always written as 24-bit BMP.
+ *
+ * @param outputFile The file where to write.
+ * @param format The requested format of BMP.
+ *
+ * @return True if the whole image was written, otherwise false.
+ */
+bool Image::saveBmp(FILE* outputFile, BmpFormat format) const
+{
+	BmpWriter bmpWriter(outputFile);
+	return saveBmp(bmpWriter, format);
+}
+
+/**
+ * Saves the image as BMP through the writer, which can write into the memory.
+ * See saveBmp(FILE*, BmpFormat).
+ *
+ * @param bmpWriter The writer of output BMP.
+ * @param format The requested format of BMP.
+ *
+ * @return True if the whole image was written, otherwise false.
+ */
+bool Image::saveBmp(BmpWriter& bmpWriter, BmpFormat format) const
+{
+	if (format == BMP_FORMAT_RLE8 && isIndexed())
+		return writeBmpRle8(bmpWriter);
+
+	std::size_t bytesPerPixel = (format == BMP_FORMAT_8BIT && isIndexed()) ? 1 : 3;
+	std::uint64_t dataSize = static_cast<std::uint64_t>(BmpWriter::paddedRowSize(_width, bytesPerPixel)) * _height;
+
+	if (!bmpWriter.writeHeader(_width, _height, static_cast<std::uint16_t>(bytesPerPixel * 8), BMP_COMPRESSION_NONE,
+			bytesPerPixel == 1 ? &_palette : nullptr, dataSize))
+		return false;
+
+	return writeBmpRows(bmpWriter, bytesPerPixel);
+}
+
+/**
+ * Writes pixel data. Rows are put bottom-up into the reusable buffer which is written
+ * out in large chunks. Rows of 1 byte per pixel are indices copied as they are,
+ * rows of 3 bytes per pixel are expanded into BGR.
+ *
+ * @param bmpWriter The writer of output BMP.
+ * @param bytesPerPixel 1 for indices, 3 for BGR.
+ *
+ * @return True if all rows were written, otherwise false.
+ */
+bool Image::writeBmpRows(BmpWriter& bmpWriter, std::size_t bytesPerPixel) const
+{
+	// Scan line needs to be aligned to 4 bytes
+	std::size_t paddedRowSize = BmpWriter::paddedRowSize(_width, bytesPerPixel);
+	if (paddedRowSize == 0)
+		return true;
+
+	// Buffer holds as many whole rows as fit into the output chunk, padding bytes stay zero
+	std::size_t rowsPerChunk = std::max<std::size_t>(BMP_OUTPUT_CHUNK_SIZE / paddedRowSize, 1);
+	ArenaVector<std::uint8_t> buffer(rowsPerChunk * paddedRowSize, 0, getAllocator());
+	std::size_t bufferPos = 0;
 
-	// Pixel Data
-	std::size_t sizeOfData = 0;
 	// BMP has data written from bottom to top and from left to right
-	// So we need to start from the bottom Y line and from the leftmost X point and start writing
 	for (std::int32_t y = _height - 1; y >= 0; --y)
 	{
-		for (std::int32_t x = 0; x < _width; ++x)
-		{
-			const Pixel& pixel = _pixels[(y * _width) + x];
-
-			outputBuffer.append(DataValue(static_cast<std::uint8_t>(pixel.color.blue)));
-			outputBuffer.append(DataValue(static_cast<std::uint8_t>(pixel.color.green)));
-			outputBuffer.append(DataValue(static_cast<std::uint8_t>(pixel.color.red)));
-			sizeOfData += 3;
+		if (bytesPerPixel == 1)
+			std::copy_n(_indices.data() + static_cast<std::size_t>(y) * _width, _width, buffer.data() + bufferPos);
+		else
+			expandRow(static_cast<std::uint16_t>(y), buffer.data() + bufferPos, bytesPerPixel);
+		bufferPos += paddedRowSize;
 
-			// End of scan line
-			// We need to add padding
-			// Scan line needs to be aligned to 4 bytes
-			if (x + 1 == _width)
-			{
-				std::uint64_t padding = alignUp(sizeOfData, 4) - sizeOfData;
-				for (std::uint64_t i = 0; i < padding; i++)
-					outputBuffer.append(DataValue(static_cast<std::uint8_t>(0)));
+		if (bufferPos == buffer.size() || y == 0)
+		{
+			if (!bmpWriter.writeData(buffer.data(), bufferPos))
+				return false;
 
-				sizeOfData += padding;
-			}
+			bufferPos = 0;
 		}
 	}
 
-	outputBuffer.write(2, DataValue(static_cast<std::uint32_t>(54 + sizeOfData))); // Write back file size
+	return true;
+}
+
+/**
+ * Writes indexed image as BMP compressed by RLE8. Size of pixel data has to be
+ * in the header, so the rows are encoded into memory first.
+ *
+ * @param bmpWriter The writer of output BMP.
+ *
+ * @return True if everything was written, otherwise false.
+ */
+bool Image::writeBmpRle8(BmpWriter& bmpWriter) const
+{
+	// Every index takes 2 bytes at most, so the whole output fits without growing in the arena
+	ArenaVector<std::uint8_t> data(getAllocator());
+	data.reserve(static_cast<std::size_t>(_height) * (2 * static_cast<std::size_t>(_width) + 2));
+
+	// BMP has data written from bottom to top, every row ends with end of line, the last one with end of bitmap
+	for (std::int32_t y = _height - 1; y >= 0; --y)
+	{
+		encodeRle8Row(_indices.data() + static_cast<std::size_t>(y) * _width, _width, data);
+		data.push_back(0);
+		data.push_back(y == 0 ? 1 : 0);
+	}
 
-	if (!outputBuffer.writeToFile(outputFile))
+	if (!bmpWriter.writeHeader(_width, _height, 8, BMP_COMPRESSION_RLE8, &_palette, data.size()))
 		return false;
 
-	return true;
+	return bmpWriter.writeData(data.data(), data.size());
+}
+
+/**
+ * Encodes single row of indices by RLE8. Runs of at least 3 same indices are stored
+ * as encoded runs of count and index. Everything between them is stored in absolute
+ * mode, which needs at least 3 indices, shorter parts are stored as encoded runs.
+ *
+ * @param indices The row of indices.
+ * @param size The number of indices in the row.
+ * @param output The buffer where encoded row is appended, without end of line.
+ */
+void Image::encodeRle8Row(const std::uint8_t* indices, std::size_t size, ArenaVector<std::uint8_t>& output)
+{
+	auto runLength = [&](std::size_t pos) {
+		std::size_t end = std::min<std::size_t>(size, pos + RLE8_MAX_RUN);
+		std::size_t runEnd = pos + 1;
+		while (runEnd < end && indices[runEnd] == indices[pos])
+			++runEnd;
+		return runEnd - pos;
+	};
+
+	std::size_t pos = 0;
+	while (pos < size)
+	{
+		std::size_t run = runLength(pos);
+		if (run >= RLE8_MIN_RUN)
+		{
+			output.push_back(static_cast<std::uint8_t>(run));
+			output.push_back(indices[pos]);
+			pos += run;
+			continue;
+		}
+
+		// Literal part ends where the next run starts
+		std::size_t literalEnd = pos + run;
+		while (literalEnd < size && literalEnd - pos < RLE8_MAX_RUN)
+		{
+			run = runLength(literalEnd);
+			if (run >= RLE8_MIN_RUN)
+				break;
+
+			literalEnd = std::min<std::size_t>(literalEnd + run, pos + RLE8_MAX_RUN);
+		}
+
+		std::size_t literal = literalEnd - pos;
+		if (literal >= RLE8_MIN_RUN)
+		{
+			// Absolute mode is padded to 16-bit boundary
+			output.push_back(0);
+			output.push_back(static_cast<std::uint8_t>(literal));
+			output.insert(output.end(), indices + pos, indices + literalEnd);
+			if (literal & 1)
+				output.push_back(0);
+			pos = literalEnd;
+		}
+		else
+		{
+			for (; pos < literalEnd; pos += run)
+			{
+				run = std::min(runLength(pos), literalEnd - pos);
+				output.push_back(static_cast<std::uint8_t>(run));
+				output.push_back(indices[pos]);
+			}
+		}
+	}
 }
@@ -2,39 +2,64 @@
 #define IMAGE_H
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
+#include "arena.h"
+#include "bmp_writer.h"
+#include "palette.h"
 #include "utils.h"
 
+enum BmpFormat
+{
+	BMP_FORMAT_24BIT,
+	BMP_FORMAT_8BIT,
+	BMP_FORMAT_RLE8
+};
+
+
+/**
+ * Decoded image stored row by row from the top. Pixels are stored either as indices
+ * into the palette, which takes single byte per pixel, or as colors, when they
+ * cannot be described by single palette. Position of the pixel is given by its
+ * position in the plane. Planes are moved in, never copied. Buffers which
+ * are needed to save the image come from the arena of its plane.
+ */
 class Image
 {
 public:
-	struct Point
-	{
-		Point() : x(0), y(0) {}
-		Point(const Point& point) : x(point.x), y(point.y) {}
+	Image(std::uint16_t width, std::uint16_t height, ArenaVector<Color>&& colors);
+	Image(std::uint16_t width, std::uint16_t height, ArenaVector<std::uint8_t>&& indices, const Palette& palette);
 
-		std::uint16_t x;
-		std::uint16_t y;
-	};
+	std::uint16_t getWidth() const;
+	std::uint16_t getHeight() const;
+	bool isIndexed() const;
+	const ArenaVector<std::uint8_t>& getIndices() const;
+	const Palette& getPalette() const;
+	const ArenaVector<Color>& getColors() const;
+	ArenaVector<std::uint8_t> releaseIndices();
+	ArenaVector<Color> releaseColors();
 
-	struct Pixel
-	{
-		Pixel() : coord(), color() {}
-		Pixel(const Pixel& pixel) : coord(pixel.coord), color(pixel.color) {}
+	Color getColor(std::uint16_t x, std::uint16_t y) const;
+	void expandRow(std::uint16_t y, std::uint8_t* output, std::size_t bytesPerPixel) const;
+	std::unique_ptr<Image> scale(std::uint16_t width, std::uint16_t height) const;
 
-		Point coord;
-		Color color;
-	};
+	bool saveBmp(FILE* outputFile, BmpFormat format) const;
+	bool saveBmp(BmpWriter& bmpWriter, BmpFormat format) const;
 
-	Image(std::uint16_t width, std::uint16_t height, const std::vector<Pixel>& pixels);
+private:
+	ArenaAllocator<std::uint8_t> getAllocator() const;
+	bool writeBmpRows(BmpWriter& bmpWriter, std::size_t bytesPerPixel) const;
+	bool writeBmpRle8(BmpWriter& bmpWriter) const;
 
-	bool saveBmp(FILE* outputFile) const;
+	static void encodeRle8Row(const std::uint8_t* indices, std::size_t size, ArenaVector<std::uint8_t>& output);
 
-private:
 	std::uint16_t _width;
 	std::uint16_t _height;
-	std::vector<Pixel> _pixels;
+	ArenaVector<std::uint8_t> _indices;
+	bool _indexed;
+	Palette _palette;
+	ArenaVector<Color> _colors;
 };
 
 #endif
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <utility>
+
+#include "image_scaler.h"
+
+/**
+ * Creates the scaler of the image of given size into the smaller one.
+ *
+ * @param sourceWidth The width of the source image.
+ * @param sourceHeight The height of the source image.
+ * @param width The width of the scaled image, at most the source width.
+ * @param height The height of the scaled image, at most the source height.
+ * @param arena The arena for sums and the scaled image, heap if nullptr.
+ */
+ImageScaler::ImageScaler(std::uint16_t sourceWidth, std::uint16_t sourceHeight, std::uint16_t width, std::uint16_t height, Arena* arena) :
+	_sourceWidth(sourceWidth), _sourceHeight(sourceHeight), _width(std::min(width, sourceWidth)), _height(std::min(height, sourceHeight)),
+	_columnMap(sourceWidth, 0, arena), _columnCounts(_width, 0, arena), _sums(_width * 3, 0, arena), _sourceRow(0), _row(0), _rowCount(0), _colors(arena)
+{
+	// Source column x falls into scaled column x * width / sourceWidth
+	for (std::size_t x = 0; x < _sourceWidth; ++x)
+	{
+		_columnMap[x] = static_cast<std::uint16_t>(x * _width / _sourceWidth);
+		_columnCounts[_columnMap[x]]++;
+	}
+
+	_colors.reserve(static_cast<std::size_t>(_width) * _height);
+}
+
+/**
+ * Adds the next row of the source image given by colors.
+ *
+ * @param colors Colors of the source row.
+ */
+void ImageScaler::addRow(const Color* colors)
+{
+	startRow();
+
+	for (std::size_t x = 0; x < _sourceWidth; ++x)
+	{
+		std::uint64_t* sum = &_sums[_columnMap[x] * 3];
+		sum[0] += colors[x].blue;
+		sum[1] += colors[x].green;
+		sum[2] += colors[x].red;
+	}
+}
+
+/**
+ * Adds the next row of the source image given by palette indices.
+ *
+ * @param indices Palette indices of the source row.
+ * @param palette The palette of the source image.
+ */
+void ImageScaler::addRow(const std::uint8_t* indices, const Palette& palette)
+{
+	startRow();
+
+	// Packed palette has blue in the lowest byte
+	const std::uint32_t* packed = palette.getPacked();
+	for (std::size_t x = 0; x < _sourceWidth; ++x)
+	{
+		std::uint32_t color = packed[indices[x]];
+		std::uint64_t* sum = &_sums[_columnMap[x] * 3];
+		sum[0] += color & 0xFF;
+		sum[1] += (color >> 8) & 0xFF;
+		sum[2] += (color >> 16) & 0xFF;
+	}
+}
+
+/**
+ * Creates the scaled image from the rows added so far. Scaled rows
+ * without any source row are black. The scaler cannot be used afterwards.
+ *
+ * @return The scaled image.
+ */
+std::unique_ptr<Image> ImageScaler::createImage()
+{
+	if (_rowCount > 0)
+		flushRow();
+
+	_colors.resize(static_cast<std::size_t>(_width) * _height);
+	return std::make_unique<Image>(_width, _height, std::move(_colors));
+}
+
+std::uint16_t ImageScaler::getWidth() const
+{
+	return _width;
+}
+
+std::uint16_t ImageScaler::getHeight() const
+{
+	return _height;
+}
+
+/**
+ * Computes the size of the image scaled to fit into the given size with the same aspect
+ * ratio. Images are never enlarged and the scaled size is at least single pixel.
+ *
+ * @param sourceWidth The width of the source image.
+ * @param sourceHeight The height of the source image.
+ * @param maxWidth The largest width of the scaled image, 0 for any width.
+ * @param maxHeight The largest height of the scaled image, 0 for any height.
+ * @param width The width of the scaled image.
+ * @param height The height of the scaled image.
+ */
+void ImageScaler::fitSize(std::uint16_t sourceWidth, std::uint16_t sourceHeight, std::uint16_t maxWidth, std::uint16_t maxHeight,
+	std::uint16_t& width, std::uint16_t& height)
+{
+	width = sourceWidth;
+	height = sourceHeight;
+	if (sourceWidth == 0 || sourceHeight == 0)
+		return;
+
+	// Width limits the size if maxWidth / sourceWidth <= maxHeight / sourceHeight
+	bool fitWidth = maxWidth > 0 && (maxHeight == 0 || static_cast<std::uint32_t>(maxWidth) * sourceHeight <= static_cast<std::uint32_t>(maxHeight) * sourceWidth);
+	if (fitWidth && maxWidth < sourceWidth)
+	{
+		width = maxWidth;
+		height = static_cast<std::uint16_t>(std::max<std::uint32_t>(static_cast<std::uint32_t>(sourceHeight) * maxWidth / sourceWidth, 1));
+	}
+	else if (!fitWidth && maxHeight > 0 && maxHeight < sourceHeight)
+	{
+		height = maxHeight;
+		width = static_cast<std::uint16_t>(std::max<std::uint32_t>(static_cast<std::uint32_t>(sourceWidth) * maxHeight / sourceHeight, 1));
+	}
+}
+
+/**
+ * Finishes the scaled row if the next source row falls into the following one.
+ */
+void ImageScaler::startRow()
+{
+	std::size_t row = _sourceRow++ * _height / _sourceHeight;
+	if (row != _row && _rowCount > 0)
+		flushRow();
+
+	_row = row;
+	_rowCount++;
+}
+
+/**
+ * Writes averages of accumulated sums as the scaled row and clears the sums.
+ * Rows which were skipped are black.
+ */
+void ImageScaler::flushRow()
+{
+	_colors.resize(_row * _width);
+	for (std::size_t x = 0; x < _width; ++x)
+	{
+		std::uint64_t count = static_cast<std::uint64_t>(_columnCounts[x]) * _rowCount;
+		std::uint64_t* sum = &_sums[x * 3];
+
+		// Rounded to the nearest value
+		Color color;
+		color.blue = static_cast<std::uint8_t>((sum[0] + count / 2) / count);
+		color.green = static_cast<std::uint8_t>((sum[1] + count / 2) / count);
+		color.red = static_cast<std::uint8_t>((sum[2] + count / 2) / count);
+		_colors.push_back(color);
+	}
+
+	std::fill(_sums.begin(), _sums.end(), 0);
+	_rowCount = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef IMAGE_SCALER_H
+#define IMAGE_SCALER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "arena.h"
+#include "image.h"
+#include "palette.h"
+#include "utils.h"
+
+/**
+ * Downscales the image by box filter while its rows are coming from top to bottom.
+ * Every pixel of the scaled image is the average of the source pixels which map
+ * into it. Only sums of the scaled row which is just being accumulated are kept,
+ * so the source image never has to exist at once.
+ */
+class ImageScaler
+{
+public:
+	ImageScaler(std::uint16_t sourceWidth, std::uint16_t sourceHeight, std::uint16_t width, std::uint16_t height, Arena* arena = nullptr);
+
+	void addRow(const Color* colors);
+	void addRow(const std::uint8_t* indices, const Palette& palette);
+	std::unique_ptr<Image> createImage();
+
+	std::uint16_t getWidth() const;
+	std::uint16_t getHeight() const;
+
+	static void fitSize(std::uint16_t sourceWidth, std::uint16_t sourceHeight, std::uint16_t maxWidth, std::uint16_t maxHeight,
+		std::uint16_t& width, std::uint16_t& height);
+
+private:
+	void startRow();
+	void flushRow();
+
+	std::uint16_t _sourceWidth;
+	std::uint16_t _sourceHeight;
+	std::uint16_t _width;
+	std::uint16_t _height;
+	ArenaVector<std::uint16_t> _columnMap;
+	ArenaVector<std::uint32_t> _columnCounts;
+	ArenaVector<std::uint64_t> _sums;
+	std::size_t _sourceRow;
+	std::size_t _row;
+	std::uint32_t _rowCount;
+	ArenaVector<Color> _colors;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "input_source.h"
+#include "utils.h"
+
+InputSource::InputSource() : _mapping(nullptr), _mappingSize(0), _buffer(), _memory()
+{
+}
+
+InputSource::~InputSource()
+{
+	unmap();
+}
+
+/**
+ * Replaces the contents with the contents of the whole file. Regular files
+ * are mapped, anything else is read until the end of the stream.
+ *
+ * @param file The file to read from.
+ * @param arena The arena for the contents which are read, heap if nullptr.
+ *
+ * @return True if the file was mapped or read, otherwise false.
+ */
+bool InputSource::open(FILE *file, Arena* arena)
+{
+	if (openMapped(file))
+		return true;
+
+	if (file == nullptr)
+		return false;
+
+	ArenaVector<std::uint8_t> contents{ArenaAllocator<std::uint8_t>(arena)};
+	if (!readStream(file, contents))
+		return false;
+
+	_buffer = DataBuffer(std::move(contents));
+	return true;
+}
+
+/**
+ * Replaces the contents with the whole file memory mapped.
+ *
+ * @param file The file to map.
+ *
+ * @return True if the file was mapped, otherwise false.
+ */
+bool InputSource::openMapped(FILE *file)
+{
+	close();
+	if (file == nullptr)
+		return false;
+
+	return map(file);
+}
+
+/**
+ * Replaces the contents with the memory of the caller, which is neither copied
+ * nor released. The memory has to stay valid until the contents are replaced or closed.
+ *
+ * @param data The memory with the whole input.
+ *
+ * @return True if there is any memory, otherwise false.
+ */
+bool InputSource::openMemory(const DataView& data)
+{
+	close();
+	if (data.getData() == nullptr)
+		return false;
+
+	_memory = data;
+	return true;
+}
+
+/**
+ * Releases the contents, views of them are no longer valid.
+ */
+void InputSource::close()
+{
+	unmap();
+	_buffer = DataBuffer();
+	_memory = DataView();
+}
+
+/**
+ * Returns whether the contents are memory mapped file.
+ *
+ * @return True if mapped, false if read into owned buffer or viewed in memory.
+ */
+bool InputSource::isMapped() const
+{
+	return _mapping != nullptr;
+}
+
+/**
+ * Returns the view of the whole contents. The view is valid as long as this object.
+ *
+ * @return View of the contents.
+ */
+DataView InputSource::getView() const
+{
+	if (isMapped())
+		return DataView(static_cast<const std::uint8_t*>(_mapping), _mappingSize);
+
+	if (_memory.getData() != nullptr)
+		return _memory;
+
+	return DataView(_buffer);
+}
+
+bool InputSource::map(FILE *file)
+{
+	int fd = fileno(file);
+	if (fd == -1)
+		return false;
+
+	// Only non-empty regular files can be mapped
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) == -1 || !S_ISREG(fileStat.st_mode) || fileStat.st_size <= 0)
+		return false;
+
+	void* mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapping == MAP_FAILED)
+		return false;
+
+	// The file is parsed from start to the end
+	madvise(mapping, fileStat.st_size, MADV_SEQUENTIAL);
+
+	_mapping = mapping;
+	_mappingSize = fileStat.st_size;
+	return true;
+}
+
+void InputSource::unmap()
+{
+	if (_mapping == nullptr)
+		return;
+
+	munmap(_mapping, _mappingSize);
+	_mapping = nullptr;
+	_mappingSize = 0;
+}
@@ -0,0 +1,44 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "data_buffer.h"
+
+/**
+ * This class provides read-only access to the whole contents of the input file.
+ * Regular files are memory mapped, so their contents are never copied. Inputs
+ * which cannot be mapped, like pipes, are read into single owned buffer.
+ * Input which is already in memory is only viewed.
+ * The object can be reopened with another file, so it does not have to be
+ * created for every file.
+ */
+class InputSource
+{
+public:
+	InputSource();
+	InputSource(const InputSource&) = delete;
+	~InputSource();
+
+	InputSource& operator =(const InputSource&) = delete;
+
+	bool open(FILE *file, Arena* arena = nullptr);
+	bool openMapped(FILE *file);
+	bool openMemory(const DataView& data);
+	void close();
+
+	bool isMapped() const;
+	DataView getView() const;
+
+private:
+	bool map(FILE *file);
+	void unmap();
+
+	void* _mapping;
+	std::size_t _mappingSize;
+	DataBuffer _buffer;
+	DataView _memory;
+};
+
+#endif
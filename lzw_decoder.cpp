@@ -1,67 +1,318 @@
 #include <cassert>
 #include <algorithm>
-#include <iostream>
 
 #include "lzw_decoder.h"
 
-LzwDecoder::LzwDecoder(std::uint8_t firstCodeSize, std::uint16_t codeTableSize, const DataBuffer& codedData) :
-	_firstCodeSize(firstCodeSize), _codeSize(firstCodeSize), _readPos(0), _initCodeTableSize(codeTableSize), _codeTable(), _codedData(codedData), _lastCode(nullptr)
+LzwDecoder::LzwDecoder(std::uint8_t firstCodeSize, std::uint16_t codeTableSize) :
+	_firstCodeSize(firstCodeSize), _codeSize(firstCodeSize), _initCodeTableSize(std::min(codeTableSize, MAX_CODE_COUNT)),
+	_nextCode(0), _lastCode(0), _lastCodeValid(false), _finished(false), _codeTable(), _bitReader(),
+	_output(nullptr), _outputSize(0), _outputPos(0), _pendingCode(0), _pendingLength(0)
 {
+	restart(firstCodeSize, codeTableSize);
 }
 
-bool LzwDecoder::decode(DataBuffer& decodedData)
+/**
+ * Prepares the decoder for another image with possibly different code sizes, so that
+ * the decoder and its code table can be reused instead of creating new one.
+ * Decoding itself is then started by start() or decode().
+ *
+ * @param firstCodeSize The code size right after the clear code.
+ * @param codeTableSize The number of root codes.
+ */
+void LzwDecoder::restart(std::uint8_t firstCodeSize, std::uint16_t codeTableSize)
 {
-	std::uint16_t code;
-	if (!getNextCode(code))
-		return false;
+	_firstCodeSize = firstCodeSize;
+	_codeSize = firstCodeSize;
+	_initCodeTableSize = std::min(codeTableSize, MAX_CODE_COUNT);
+	_finished = false;
+
+	// Root codes never change, so they are initialized only once and reset of code table just forgets all other codes
+	for (std::uint16_t i = 0; i < _initCodeTableSize; ++i)
+	{
+		_codeTable.prefix[i] = 0;
+		_codeTable.suffix[i] = static_cast<std::uint8_t>(i);
+		_codeTable.first[i] = static_cast<std::uint8_t>(i);
+		_codeTable.length[i] = 1;
+	}
+}
 
-	// First code needs to be always reset
-	if (!isResetCode(code))
+/**
+ * Decodes the whole chain of data sub-blocks into the caller-provided index buffer
+ * of fixed size. See start(), feed() and finish().
+ *
+ * @param codedData The data sub-blocks to decode.
+ * @param indexBuffer The buffer where to write decoded indices.
+ * @param size The size of the index buffer.
+ * @param fillIndex The index used for pixels not covered by the coded data.
+ *
+ * @return True if decoding was successful, false for malformed coded data.
+ */
+bool LzwDecoder::decode(SubBlockReader& codedData, std::uint8_t* indexBuffer, std::size_t size, std::uint8_t fillIndex)
+{
+	start(indexBuffer, size);
+	_bitReader = BitReader(&codedData);
+
+	bool result = decodeCodes();
+	finish(fillIndex);
+	return result;
+}
+
+/**
+ * Decodes the part of contiguous coded data starting at given bit position, which
+ * has to be the start of the segment, until the index buffer is full. See scanSegments().
+ *
+ * @param codedData The coded data without sub-block size bytes.
+ * @param codedSize The size of the coded data.
+ * @param bitPos The position of the first code to decode.
+ * @param indexBuffer The buffer where to write decoded indices.
+ * @param size The size of the index buffer.
+ *
+ * @return True if the whole buffer was decoded, false for malformed coded data.
+ */
+bool LzwDecoder::decode(const std::uint8_t* codedData, std::size_t codedSize, std::uint64_t bitPos, std::uint8_t* indexBuffer, std::size_t size)
+{
+	std::size_t bytePos = static_cast<std::size_t>(bitPos >> 3);
+	if (bytePos > codedSize)
 		return false;
 
-	if (!resetCodeTable(decodedData))
+	start(indexBuffer, size);
+	_bitReader = BitReader(codedData + bytePos, codedSize - bytePos);
+
+	std::uint16_t skipped;
+	if (!_bitReader.read(bitPos & 7, skipped))
 		return false;
 
-	while (true)
+	return decodeCodes() && _outputPos == _outputSize;
+}
+
+/**
+ * Splits contiguous coded data into segments at clear codes. Only the code size
+ * and the lengths of strings are tracked, strings themselves are not built,
+ * so this is much cheaper than decoding. The sizes of decoded segments
+ * tell where each segment starts in the index buffer.
+ *
+ * @param codedData The coded data without sub-block size bytes.
+ * @param codedSize The size of the coded data.
+ * @param firstCodeSize The code size right after the clear code.
+ * @param codeTableSize The number of root codes.
+ * @param segments The found segments.
+ *
+ * @return True if the coded data are valid, false for malformed coded data.
+ */
+bool LzwDecoder::scanSegments(const std::uint8_t* codedData, std::size_t codedSize, std::uint8_t firstCodeSize, std::uint16_t codeTableSize,
+	std::vector<Segment>& segments)
+{
+	codeTableSize = std::min(codeTableSize, MAX_CODE_COUNT);
+	const std::uint16_t resetCode = codeTableSize;
+	const std::uint16_t endCode = codeTableSize + 1;
+
+	std::uint16_t length[MAX_CODE_COUNT];
+	std::fill(length, length + MAX_CODE_COUNT, 1);
+	BitReader bitReader(codedData, codedSize);
+	std::uint8_t codeSize = firstCodeSize;
+	std::uint16_t nextCode = codeTableSize + 2;
+	std::uint16_t lastCode = 0;
+	bool lastCodeValid = false;
+
+	segments.assign(1, Segment{0, 0});
+
+	std::uint16_t code;
+	while (bitReader.read(codeSize, code))
 	{
-		if (!getNextCode(code))
+		if (code == endCode)
+			break;
+
+		if (code == resetCode)
+		{
+			codeSize = firstCodeSize;
+			nextCode = codeTableSize + 2;
+			lastCodeValid = false;
+
+			// Segment without any codes is just moved behind the clear code
+			if (segments.back().decodedSize == 0)
+				segments.back().bitPos = bitReader.getBitPos();
+			else
+				segments.push_back(Segment{bitReader.getBitPos(), 0});
+
+			continue;
+		}
+
+		// The same rules as in decodeCodes(), new code is always last code + one byte
+		if (!lastCodeValid)
+		{
+			if (code >= codeTableSize)
+				return false;
+		}
+		else if (code > nextCode)
+		{
 			return false;
+		}
+		else if (nextCode < MAX_CODE_COUNT)
+		{
+			length[nextCode++] = length[lastCode] + 1;
+			if (nextCode >= (1 << codeSize) && codeSize < MAX_CODE_SIZE)
+				codeSize++;
+		}
+
+		segments.back().decodedSize += length[code];
+		lastCode = code;
+		lastCodeValid = true;
+	}
+
+	return true;
+}
+
+/**
+ * Starts decoding into the caller-provided index buffer of fixed size. The buffer
+ * is never reallocated. Coded data are then passed in arbitrary-sized
+ * chunks using feed().
+ *
+ * @param indexBuffer The buffer where to write decoded indices.
+ * @param size The size of the index buffer.
+ */
+void LzwDecoder::start(std::uint8_t* indexBuffer, std::size_t size)
+{
+	_output = indexBuffer;
+	_outputSize = size;
+	_outputPos = 0;
+	_pendingLength = 0;
+	_finished = false;
+	_bitReader = BitReader();
+
+	resetCodeTable();
+}
+
+/**
+ * Decodes the next chunk of coded data. Codes split between two chunks are
+ * decoded once the next chunk is fed. Decoding stops once the buffer is full
+ * even if there are more codes.
+ *
+ * @param data The chunk of coded data.
+ * @param size The size of the chunk.
+ *
+ * @return True if decoding was successful, false for malformed coded data.
+ */
+bool LzwDecoder::feed(const std::uint8_t* data, std::size_t size)
+{
+	if (_finished)
+		return true;
+
+	_bitReader.setData(data, size);
+	return decodeCodes();
+}
+
+/**
+ * Continues decoding into another index buffer once the previous one is full.
+ * The rest of the string which did not fit into the previous buffer is written
+ * first and then the coded data which were left from the last feed() are decoded.
+ * This way only small window of the output has to be kept in memory.
+ *
+ * @param indexBuffer The buffer where to write decoded indices.
+ * @param size The size of the index buffer.
+ *
+ * @return True if decoding was successful, false for malformed coded data.
+ */
+bool LzwDecoder::resume(std::uint8_t* indexBuffer, std::size_t size)
+{
+	_output = indexBuffer;
+	_outputSize = size;
+	_outputPos = 0;
+
+	return decodeCodes();
+}
 
-		// Find the code in code table
-		Code* codeObj = isInCodeTable(code);
+/**
+ * Finishes decoding. If the end code came before the buffer was full or
+ * coded data were cut short, the rest of the buffer is filled with fill index.
+ *
+ * @param fillIndex The index used for pixels not covered by the coded data.
+ */
+void LzwDecoder::finish(std::uint8_t fillIndex)
+{
+	if (_outputPos < _outputSize)
+		std::fill(_output + _outputPos, _output + _outputSize, fillIndex);
+
+	_finished = true;
+}
+
+/**
+ * Returns whether the end code was hit or the index buffer is full, so no
+ * more coded data are needed until another buffer is given by resume().
+ *
+ * @return True if finished, otherwise false.
+ */
+bool LzwDecoder::isFinished() const
+{
+	return _finished || _outputPos >= _outputSize;
+}
+
+/**
+ * Returns the number of indices which were actually decoded, without the fill.
+ *
+ * @return The number of decoded indices.
+ */
+std::size_t LzwDecoder::getDecodedSize() const
+{
+	return _outputPos;
+}
+
+/**
+ * Decodes codes until the end code, full output or until the coded data
+ * available so far are exhausted. State is kept in the members, so decoding
+ * can continue once more data are available.
+ *
+ * @return False for malformed coded data, otherwise true.
+ */
+bool LzwDecoder::decodeCodes()
+{
+	// Rest of the string which did not fit into the previous buffer
+	if (_pendingLength > 0 && !writePending())
+		return true;
+
+	std::uint16_t code;
+	while (!_finished)
+	{
+		// Wait for more coded data
+		if (!getNextCode(code))
+			break;
 
 		if (isEndCode(code))
 		{
+			_finished = true;
 			break;
 		}
 		else if (isResetCode(code))
 		{
-			if (!resetCodeTable(decodedData))
-				return false;
-
+			resetCodeTable();
 			continue;
 		}
-		// Existing code
-		else if (codeObj != nullptr)
+		// Code after reset is just written to output and remembered as last code
+		else if (!_lastCodeValid)
 		{
-			assert(_lastCode);
-			decodedData.append(codeObj->data);
-
-			// For existing code, create new code with the first free index, what is size of code table
-			createNewCode(_codeTable.size(), codeObj->data[0]);
+			if (code >= _initCodeTableSize)
+				return false;
+		}
+		// Existing code, new code is last code + first byte of this code
+		else if (isInCodeTable(code))
+		{
+			createNewCode(_lastCode, _codeTable.first[code]);
+		}
+		// New code, it has to be the first free code and it is last code + first byte of last code
+		else if (code == _nextCode)
+		{
+			createNewCode(_lastCode, _codeTable.first[_lastCode]);
 		}
-		// New code
 		else
 		{
-			assert(_lastCode);
-			decodedData.append(_lastCode->data);
-			decodedData.append(_lastCode->data[0]);
-
-			// We need to create new code with this non-existing code index
-			createNewCode(code, _lastCode->data[0]);
+			return false;
 		}
 
-		_lastCode = isInCodeTable(code);
+		_lastCode = code;
+		_lastCodeValid = true;
+
+		// Output is full, codes are left in the coded data until more output is available
+		if (!writeCode(code))
+			break;
 	}
 
 	return true;
@@ -69,98 +320,95 @@ bool LzwDecoder::decode(DataBuffer& decodedData)
 
 bool LzwDecoder::isResetCode(std::uint16_t code)
 {
-	if (_codeTable.empty())
-		return code == _initCodeTableSize;
-
-	Code* codeObj = isInCodeTable(code);
-	return codeObj ? codeObj->reset : false;
+	return code == _initCodeTableSize;
 }
 
 bool LzwDecoder::isEndCode(std::uint16_t code)
 {
-	if (_codeTable.empty())
-		return code == _initCodeTableSize + 1;
-
-	Code* codeObj = isInCodeTable(code);
-	return codeObj ? codeObj->end : false;
+	return code == _initCodeTableSize + 1;
 }
 
 bool LzwDecoder::getNextCode(std::uint16_t& code)
 {
-	// Not enough bits in coded data
-	if (_readPos + _codeSize > (_codedData.getSize() * 8))
-		return false;
-
-	code = _codedData.readBits(_readPos, _codeSize).getInt<std::uint16_t>();
-	_readPos += _codeSize;
-	return true;
+	// Fails if there is not enough bits in coded data
+	return _bitReader.read(_codeSize, code);
 }
 
-bool LzwDecoder::resetCodeTable(DataBuffer& decodedData)
+void LzwDecoder::resetCodeTable()
 {
 	_codeSize = _firstCodeSize;
 
-	_codeTable.clear();
-	for (std::uint16_t i = 0; i < _initCodeTableSize; ++i)
-	{
-		Code newCode;
-		newCode.reset = newCode.end = false;
-		newCode.index = i;
-		newCode.data = { static_cast<std::uint8_t>(i) };
-		_codeTable.insert( { newCode.index, newCode } );
-	}
-
-	// Clear code
-	Code resetCode;
-	resetCode.reset = true;
-	resetCode.end = false;
-	resetCode.index = _initCodeTableSize;
-	resetCode.data = {};
-	_codeTable.insert( { resetCode.index, resetCode } );
-
-	// End of Information code
-	Code endCode;
-	endCode.reset = false;
-	endCode.end = true;
-	endCode.index = _initCodeTableSize + 1;
-	endCode.data = {};
-	_codeTable.insert( { endCode.index, endCode } );
-
-	// Not enough bits in coded data
-	std::uint16_t code;
-	if (!getNextCode(code))
-		return false;
-
-	// Code after reset is just read, its value should be in code table, index is written to output and it is remembered as last code
-	Code* codeObj = isInCodeTable(code);
-	if (codeObj == nullptr)
-		return false;
+	// Clear code and End of Information code occupy two codes right after the root codes
+	_nextCode = _initCodeTableSize + 2;
 
-	decodedData.append(codeObj->data);
-	_lastCode = codeObj;
-	return true;
+	// There is no previous code right after the reset
+	_lastCodeValid = false;
 }
 
-void LzwDecoder::createNewCode(std::uint16_t index, std::uint8_t appendByte)
+void LzwDecoder::createNewCode(std::uint16_t prefixCode, std::uint8_t appendByte)
 {
-	Code newCode;
-	newCode.index = index;
-	newCode.data = _lastCode->data;
-	newCode.data.push_back(appendByte);
-	_codeTable.insert( { newCode.index, newCode } );
+	// Code table is full, encoder is expected to send reset code and until then no new codes are created
+	if (_nextCode >= MAX_CODE_COUNT)
+		return;
 
-	// If the new index is maximum value on _codeSize number of bytes and _codeSize is less than 12
+	_codeTable.prefix[_nextCode] = prefixCode;
+	_codeTable.suffix[_nextCode] = appendByte;
+	_codeTable.first[_nextCode] = _codeTable.first[prefixCode];
+	_codeTable.length[_nextCode] = _codeTable.length[prefixCode] + 1;
+	_nextCode++;
+
+	// If the new code does not fit into _codeSize number of bits and _codeSize is less than 12
 	//   then we need to increase the _codeSize
-	if (newCode.index >= ((1 << _codeSize) - 1))
+	if (_nextCode >= (1 << _codeSize))
 		if (_codeSize < MAX_CODE_SIZE)
 			_codeSize++;
 }
 
-LzwDecoder::Code* LzwDecoder::isInCodeTable(std::uint16_t code)
+bool LzwDecoder::isInCodeTable(std::uint16_t code)
 {
-	auto itr = _codeTable.find(code);
-	if (itr == _codeTable.end())
-		return nullptr;
+	return (code < _nextCode) && !isResetCode(code) && !isEndCode(code);
+}
+
+/**
+ * Writes the string of the code to the output. See writePending().
+ *
+ * @param code The code to write.
+ *
+ * @return True if there is still space in the output, otherwise false.
+ */
+bool LzwDecoder::writeCode(std::uint16_t code)
+{
+	_pendingCode = code;
+	_pendingLength = _codeTable.length[code];
+	return writePending();
+}
+
+/**
+ * Writes the end of the string of pending code which was not written yet. The string
+ * is written from its last byte to the first one by following the prefix codes.
+ * If it does not fit into the output, only its beginning is written and the rest
+ * stays pending.
+ *
+ * @return True if there is still space in the output, otherwise false.
+ */
+bool LzwDecoder::writePending()
+{
+	std::uint16_t code = _pendingCode;
+	std::size_t available = _outputSize - _outputPos;
+
+	// Skip the bytes from the end of the string which do not fit
+	for (std::size_t i = _pendingLength; i > available; --i)
+		code = _codeTable.prefix[code];
+
+	std::size_t length = std::min(_pendingLength, available);
+	std::uint8_t* out = _output + _outputPos;
+	for (std::size_t i = length; i > 0; --i)
+	{
+		out[i - 1] = _codeTable.suffix[code];
+		code = _codeTable.prefix[code];
+	}
 
-	return &(itr->second);
+	_outputPos += length;
+	_pendingLength -= length;
+	return _outputPos < _outputSize;
 }
@@ -2,51 +2,88 @@
 #define LZW_DECODER_H
 
 #include <cstdint>
-#include <unordered_map>
 #include <vector>
 
-#include "data_buffer.h"
+#include "bit_reader.h"
+#include "sub_block_reader.h"
 
 const std::uint16_t MAX_CODE_SIZE = 12;
+const std::uint16_t MAX_CODE_COUNT = 1 << MAX_CODE_SIZE;
 
 class LzwDecoder
 {
 public:
-	struct Code
+	/**
+	 * Code table stored as flat arrays indexed by the code. Every code is represented
+	 * by the code of its prefix and the byte appended to it, so creating new code
+	 * never allocates. First byte and length of the whole string are cached so
+	 * the string can be written backwards directly into the output.
+	 */
+	struct CodeTable
 	{
-		Code() : reset(false), end(false), index(0), data() {}
-		Code(const Code& code) : reset(code.reset), end(code.end), index(code.index), data(code.data) {}
+		std::uint16_t prefix[MAX_CODE_COUNT];
+		std::uint8_t suffix[MAX_CODE_COUNT];
+		std::uint8_t first[MAX_CODE_COUNT];
+		std::uint16_t length[MAX_CODE_COUNT];
+	};
 
-		bool reset;
-		bool end;
-		std::uint16_t index;
-		std::vector<std::uint8_t> data;
+	/**
+	 * Part of coded data which starts right after the clear code. The code table is
+	 * empty at its start, so it can be decoded independently of the data before it.
+	 */
+	struct Segment
+	{
+		std::uint64_t bitPos;
+		std::uint64_t decodedSize;
 	};
 
-	using CodeTable = std::unordered_map<std::uint16_t, Code>;
+	LzwDecoder(std::uint8_t firstCodeSize, std::uint16_t codeTableSize);
+
+	void restart(std::uint8_t firstCodeSize, std::uint16_t codeTableSize);
 
-	LzwDecoder(std::uint8_t firstCodeSize, std::uint16_t codeTableSize, const DataBuffer& codedData);
+	bool decode(SubBlockReader& codedData, std::uint8_t* indexBuffer, std::size_t size, std::uint8_t fillIndex);
+	bool decode(const std::uint8_t* codedData, std::size_t codedSize, std::uint64_t bitPos, std::uint8_t* indexBuffer, std::size_t size);
 
-	bool decode(DataBuffer& decodedData);
+	void start(std::uint8_t* indexBuffer, std::size_t size);
+	bool feed(const std::uint8_t* data, std::size_t size);
+	bool resume(std::uint8_t* indexBuffer, std::size_t size);
+	void finish(std::uint8_t fillIndex);
+
+	bool isFinished() const;
+	std::size_t getDecodedSize() const;
+
+	static bool scanSegments(const std::uint8_t* codedData, std::size_t codedSize, std::uint8_t firstCodeSize, std::uint16_t codeTableSize,
+		std::vector<Segment>& segments);
 
 protected:
+	bool decodeCodes();
+
 	bool isResetCode(std::uint16_t code);
 	bool isEndCode(std::uint16_t code);
 
 	bool getNextCode(std::uint16_t& code);
-	void createNewCode(std::uint16_t index, std::uint8_t appendByte);
+	void createNewCode(std::uint16_t prefixCode, std::uint8_t appendByte);
 
-	Code* isInCodeTable(std::uint16_t code);
-	bool resetCodeTable(DataBuffer& decodedData);
+	bool isInCodeTable(std::uint16_t code);
+	void resetCodeTable();
+	bool writeCode(std::uint16_t code);
+	bool writePending();
 
 private:
 	std::uint8_t _firstCodeSize;
 	std::uint8_t _codeSize;
-	std::uint64_t _readPos;
 	std::uint16_t _initCodeTableSize;
+	std::uint16_t _nextCode;
+	std::uint16_t _lastCode;
+	bool _lastCodeValid;
+	bool _finished;
 	CodeTable _codeTable;
-	DataBuffer _codedData;
-	Code* _lastCode;
+	BitReader _bitReader;
+	std::uint8_t* _output;
+	std::size_t _outputSize;
+	std::size_t _outputPos;
+	std::uint16_t _pendingCode;
+	std::size_t _pendingLength;
 };
 
 #endif
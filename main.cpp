@@ -1,4 +1,7 @@
+#include <cctype>
+#include <cerrno>
 #include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <getopt.h>
 #include <iostream>
@@ -12,17 +15,24 @@ enum ArgsFlags
 	ARGS_INPUT_FILE   = 1,
 	ARGS_OUTPUT_FILE  = 2,
 	ARGS_LOG_FILE     = 4,
-	ARGS_HELP         = 8
+	ARGS_HELP         = 8,
+	ARGS_PROBE        = 16,
+	ARGS_FRAMES       = 32,
+	ARGS_BITS         = 64
 };
 
 struct ArgsInfo
 {
-	ArgsInfo() : flags(ARGS_NONE), inputFileName(""), outputFileName(""), logFileName("") {}
+	ArgsInfo() : flags(ARGS_NONE), inputFileName(""), outputFileName(""), logFileName(""), options()
+	{
+		gif2bmpDefaultOptions(&options);
+	}
 
 	uint32_t flags;
 	std::string inputFileName;
 	std::string outputFileName;
 	std::string logFileName;
+	tGIF2BMPOPTIONS options;
 };
 
 void printHelp()
@@ -39,14 +49,99 @@ void printHelp()
 		<< "    -h                          Prints this help message.\n"
 		<< "    -i <ifile>                  Specifies input GIF file. If not specified, STDIN is used.\n"
 		<< "    -o <ofile>                  Specifies output BMP file. If not specified, STDOUT is used.\n"
-		<< "    -l <logfile>                Specified file for logging messages. If not specified, no logging messages are generated."
+		<< "    -l <logfile>                Specified file for logging messages. If not specified, no logging messages are generated.\n"
+		<< "    -f                          Writes every frame of animation into separate BMP file <ofile>_NNNN.bmp. Requires -o.\n"
+		<< "    -t <threads>                Decodes frames of animation in parallel using given number of threads. 0 uses all CPUs.\n"
+		<< "    -b <bits>                   Specifies depth of output BMP, 24 (default) or 8. Images with more than 256 colors are always 24-bit.\n"
+		<< "    -r                          Compresses 8-bit output BMP by RLE8. Implies -b 8, cannot be combined with -b 24.\n"
+		<< "    -c <x>,<y>,<w>,<h>          Decodes and writes only given region of the image, decoding stops after its last row.\n"
+		<< "    -d <w>,<h>                  Downscales the image to fit into given size keeping its aspect ratio, 0 for no limit. Output is 24-bit.\n"
+		<< "    -m <p>,<f>,<d>,<ms>,<r>     Limits pixels of canvas and every frame, frames, pixels of all frames, decoding time\n"
+		<< "                                and pixels per byte of compressed data for untrusted input, 0 for no limit. Exits with 2 when exceeded.\n"
+		<< "    -s                          Streams rows of single-frame non-interlaced GIF into top-down 24-bit BMP without keeping the whole image in memory.\n"
+		<< "                                Input which is not a regular file, like STDIN from a pipe, is still read whole before decoding starts.\n"
+		<< "    -p                          Prints dimensions, frame count and size of data of input GIF into output instead of converting it."
 		<< std::endl;
 }
 
+void printGifInfo(const tGIFINFO& gifInfo, FILE* output)
+{
+	fprintf(output, "Width: %u\n", gifInfo.width);
+	fprintf(output, "Height: %u\n", gifInfo.height);
+	fprintf(output, "Frames: %u\n", gifInfo.frameCount);
+	fprintf(output, "Interlaced frames: %u\n", gifInfo.interlacedFrameCount);
+	fprintf(output, "Global color table size: %u\n", gifInfo.globalColorTableSize);
+	fprintf(output, "Max. local color table size: %u\n", gifInfo.maxLocalColorTableSize);
+	fprintf(output, "Compressed data size: %lld\n", static_cast<long long>(gifInfo.compressedSize));
+	fprintf(output, "Pixels to decode: %lld\n", static_cast<long long>(gifInfo.pixelCount));
+}
+
+bool parseNumbers(const char* arg, unsigned long long* values, std::size_t count, unsigned long long maxValue)
+{
+	const char* pos = arg;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		// strtoull() accepts leading spaces and sign and wraps "-1" around, only plain digits are allowed
+		if (!isdigit(static_cast<unsigned char>(*pos)))
+			return false;
+
+		char* end;
+		errno = 0;
+		values[i] = strtoull(pos, &end, 10);
+		if (errno == ERANGE || values[i] > maxValue || *end != (i + 1 < count ? ',' : '\0'))
+			return false;
+
+		pos = end + 1;
+	}
+
+	return true;
+}
+
+bool parseRegion(const char* arg, tGIF2BMPOPTIONS& options)
+{
+	unsigned long long values[4];
+	if (!parseNumbers(arg, values, 4, UINT16_MAX))
+		return false;
+
+	options.regionX = static_cast<std::uint16_t>(values[0]);
+	options.regionY = static_cast<std::uint16_t>(values[1]);
+	options.regionWidth = static_cast<std::uint16_t>(values[2]);
+	options.regionHeight = static_cast<std::uint16_t>(values[3]);
+	return options.regionWidth > 0 && options.regionHeight > 0;
+}
+
+bool parseThumbnail(const char* arg, tGIF2BMPOPTIONS& options)
+{
+	unsigned long long values[2];
+	if (!parseNumbers(arg, values, 2, UINT16_MAX))
+		return false;
+
+	options.thumbnailWidth = static_cast<std::uint16_t>(values[0]);
+	options.thumbnailHeight = static_cast<std::uint16_t>(values[1]);
+	return options.thumbnailWidth > 0 || options.thumbnailHeight > 0;
+}
+
+bool parseLimits(const char* arg, tGIF2BMPOPTIONS& options)
+{
+	unsigned long long values[5];
+	if (!parseNumbers(arg, values, 5, UINT64_MAX))
+		return false;
+
+	if (values[1] > UINT32_MAX || values[3] > UINT32_MAX || values[4] > UINT32_MAX)
+		return false;
+
+	options.maxPixels = values[0];
+	options.maxFrames = static_cast<std::uint32_t>(values[1]);
+	options.maxDecodedPixels = values[2];
+	options.maxTime = static_cast<std::uint32_t>(values[3]);
+	options.maxExpansionRatio = static_cast<std::uint32_t>(values[4]);
+	return true;
+}
+
 bool parseArgs(ArgsInfo& argsInfo, int argc, char *argv[])
 {
 	int opt;
-	while ((opt = getopt(argc, argv, "i:o:l:h")) != -1)
+	while ((opt = getopt(argc, argv, "i:o:l:hpft:b:rsc:d:m:")) != -1)
 	{
 		switch (opt)
 		{
@@ -65,21 +160,73 @@ bool parseArgs(ArgsInfo& argsInfo, int argc, char *argv[])
 			case 'h':
 				argsInfo.flags |= ARGS_HELP;
 				break;
+			case 'p':
+				argsInfo.flags |= ARGS_PROBE;
+				break;
+			case 'f':
+				argsInfo.flags |= ARGS_FRAMES;
+				break;
+			case 't':
+			{
+				unsigned long long threadCount;
+				if (!parseNumbers(optarg, &threadCount, 1, UINT32_MAX))
+					return false;
+
+				argsInfo.options.threadCount = static_cast<std::uint32_t>(threadCount);
+				break;
+			}
+			case 'b':
+			{
+				unsigned long long bitsPerPixel;
+				if (!parseNumbers(optarg, &bitsPerPixel, 1, UINT16_MAX) || (bitsPerPixel != 24 && bitsPerPixel != 8))
+					return false;
+
+				argsInfo.flags |= ARGS_BITS;
+				argsInfo.options.bitsPerPixel = static_cast<std::uint16_t>(bitsPerPixel);
+				break;
+			}
+			case 'r':
+				argsInfo.options.rle = 1;
+				break;
+			case 's':
+				argsInfo.options.streaming = 1;
+				break;
+			case 'c':
+				if (!parseRegion(optarg, argsInfo.options))
+					return false;
+				break;
+			case 'd':
+				if (!parseThumbnail(optarg, argsInfo.options))
+					return false;
+				break;
+			case 'm':
+				if (!parseLimits(optarg, argsInfo.options))
+					return false;
+				break;
 			default:
 				return false;
 		}
 	}
 
+	// RLE8 exists only for 8-bit BMP, so it contradicts explicit -b 24 in any order
+	if (argsInfo.options.rle)
+	{
+		if ((argsInfo.flags & ARGS_BITS) && argsInfo.options.bitsPerPixel != 8)
+			return false;
+
+		argsInfo.options.bitsPerPixel = 8;
+	}
+
 	return true;
 }
 
-bool processArgs(const ArgsInfo &argsInfo, tGIF2BMP& convReport)
+int processArgs(const ArgsInfo &argsInfo, tGIF2BMP& convReport)
 {
 	// Print help if -h was specified
 	if (argsInfo.flags & ARGS_HELP)
 	{
 		printHelp();
-		return true;
+		return 0;
 	}
 
 	// Handle input file
@@ -88,18 +235,22 @@ bool processArgs(const ArgsInfo &argsInfo, tGIF2BMP& convReport)
 	{
 		FILE *fi = fopen(argsInfo.inputFileName.c_str(), "rb");
 		if (fi == nullptr)
-			return false;
+			return 1;
 
 		input = fi;
 	}
 
+	// Frames are written into files named after output file
+	if ((argsInfo.flags & ARGS_FRAMES) && !(argsInfo.flags & ARGS_OUTPUT_FILE))
+		return 1;
+
 	// Handle output file
 	FILE* output = stdout;
-	if (argsInfo.flags & ARGS_OUTPUT_FILE)
+	if ((argsInfo.flags & ARGS_OUTPUT_FILE) && !(argsInfo.flags & ARGS_FRAMES))
 	{
 		FILE *fo = fopen(argsInfo.outputFileName.c_str(), "wb");
 		if (fo == nullptr)
-			return false;
+			return 1;
 
 		output = fo;
 	}
@@ -110,12 +261,29 @@ bool processArgs(const ArgsInfo &argsInfo, tGIF2BMP& convReport)
 	{
 		FILE *fl = fopen(argsInfo.logFileName.c_str(), "w");
 		if (fl == nullptr)
-			return false;
+			return 1;
 
 		log = fl;
 	}
 
-	int result = gif2bmp(&convReport, input, output);
+	int result;
+	if (argsInfo.flags & ARGS_PROBE)
+	{
+		tGIFINFO gifInfo;
+		result = gifProbe(&gifInfo, input);
+		if (result == 0)
+			printGifInfo(gifInfo, output);
+	}
+	else if (argsInfo.flags & ARGS_FRAMES)
+	{
+		std::string outputPrefix = argsInfo.outputFileName;
+		if (outputPrefix.length() >= 4 && outputPrefix.compare(outputPrefix.length() - 4, 4, ".bmp") == 0)
+			outputPrefix.erase(outputPrefix.length() - 4);
+
+		result = gif2bmpFrames(&convReport, input, (outputPrefix + "_").c_str(), &argsInfo.options);
+	}
+	else
+		result = gif2bmpEx(&convReport, input, output, &argsInfo.options);
 
 	// Cleanup
 	if (output != stdout)
@@ -125,7 +293,11 @@ bool processArgs(const ArgsInfo &argsInfo, tGIF2BMP& convReport)
 	if (log != nullptr)
 		fclose(log);
 
-	return (result == 0);
+	// Exceeded limits are told apart from invalid input
+	if (result == GIF2BMP_LIMIT_EXCEEDED)
+		return 2;
+
+	return (result == 0) ? 0 : 1;
 }
 
 int main(int argc, char *argv[])
@@ -138,5 +310,5 @@ int main(int argc, char *argv[])
 	}
 
 	tGIF2BMP convReport;
-	return processArgs(argsInfo, convReport) ? 0 : 1;
+	return processArgs(argsInfo, convReport);
 }
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "output_buffer.h"
+
+/**
+ * Creates the empty buffer which is allocated by the first write.
+ */
+OutputBuffer::OutputBuffer() : _data(nullptr), _capacity(0), _size(0), _owned(true)
+{
+}
+
+/**
+ * Creates the buffer over the memory of the caller, which is never reallocated.
+ *
+ * @param data The memory where to write, can be nullptr if capacity is 0.
+ * @param capacity The size of the memory.
+ */
+OutputBuffer::OutputBuffer(std::uint8_t* data, std::size_t capacity) : _data(data), _capacity(data ? capacity : 0), _size(0), _owned(false)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+	if (_owned)
+		std::free(_data);
+}
+
+/**
+ * Makes the owned buffer large enough for the given total size, so writes up to
+ * that size do not reallocate. The buffer of the caller is left as it is.
+ *
+ * @param size The total size of the output.
+ *
+ * @return True if the buffer was allocated, otherwise false.
+ */
+bool OutputBuffer::reserve(std::size_t size)
+{
+	if (!_owned || size <= _capacity)
+		return true;
+
+	std::uint8_t* data = static_cast<std::uint8_t*>(std::realloc(_data, size));
+	if (data == nullptr)
+		return false;
+
+	_data = data;
+	_capacity = size;
+	return true;
+}
+
+/**
+ * Appends the bytes. Owned buffer grows at least twice if they do not fit.
+ * Bytes which do not fit into the buffer of the caller are dropped and only counted.
+ *
+ * @param data The bytes to write.
+ * @param size The number of bytes.
+ *
+ * @return True if the bytes were written or counted, false if the buffer cannot grow.
+ */
+bool OutputBuffer::write(const std::uint8_t* data, std::size_t size)
+{
+	if (_owned && _size + size > _capacity && !reserve(std::max(_size + size, _capacity * 2)))
+		return false;
+
+	if (_size < _capacity)
+		std::memcpy(_data + _size, data, std::min(size, _capacity - _size));
+
+	_size += size;
+	return true;
+}
+
+/**
+ * Hands the owned buffer over to the caller, who has to free() it. The buffer is empty afterwards.
+ *
+ * @return The written bytes, nullptr if nothing was written or the buffer is not owned.
+ */
+std::uint8_t* OutputBuffer::release()
+{
+	if (!_owned)
+		return nullptr;
+
+	std::uint8_t* data = _data;
+	_data = nullptr;
+	_capacity = 0;
+	_size = 0;
+	return data;
+}
+
+/**
+ * Returns the number of bytes written so far, including those which did not fit.
+ *
+ * @return Size of the output.
+ */
+std::size_t OutputBuffer::getSize() const
+{
+	return _size;
+}
+
+/**
+ * Returns whether some bytes did not fit into the buffer of the caller.
+ *
+ * @return True if the output is incomplete, otherwise false.
+ */
+bool OutputBuffer::isTruncated() const
+{
+	return _size > _capacity;
+}
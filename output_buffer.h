@@ -0,0 +1,38 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Memory where the output is written instead of the file. It is either the buffer
+ * of the caller with fixed capacity or the buffer which is allocated by malloc()
+ * and grows as needed until it is released to the caller. Bytes which do not fit
+ * into the buffer of the caller are only counted, so the required size is known
+ * after the whole output is written.
+ */
+class OutputBuffer
+{
+public:
+	OutputBuffer();
+	OutputBuffer(std::uint8_t* data, std::size_t capacity);
+	OutputBuffer(const OutputBuffer&) = delete;
+	~OutputBuffer();
+
+	OutputBuffer& operator =(const OutputBuffer&) = delete;
+
+	bool reserve(std::size_t size);
+	bool write(const std::uint8_t* data, std::size_t size);
+	std::uint8_t* release();
+
+	std::size_t getSize() const;
+	bool isTruncated() const;
+
+private:
+	std::uint8_t* _data;
+	std::size_t _capacity;
+	std::size_t _size;
+	bool _owned;
+};
+
+#endif
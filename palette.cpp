@@ -0,0 +1,81 @@
+#include "palette.h"
+#include "palette_expander.h"
+
+Palette::Palette() : _size(0), _colors(), _packed()
+{
+	clearFrom(0);
+}
+
+/**
+ * Loads the color table of GIF, which is made of red, green and blue byte
+ * of every color. Colors after the end of color table are black.
+ *
+ * @param colorTableBuffer The color table.
+ *
+ * @return True if the color table is valid, otherwise false.
+ */
+bool Palette::load(const DataView& colorTableBuffer)
+{
+	std::size_t size = colorTableBuffer.getSize() / 3;
+	if (colorTableBuffer.getSize() % 3 != 0 || size > PALETTE_SIZE)
+		return false;
+
+	const std::uint8_t* data = colorTableBuffer.getData();
+	for (std::size_t i = 0; i < size; ++i, data += 3)
+	{
+		_colors[i].red = data[0];
+		_colors[i].green = data[1];
+		_colors[i].blue = data[2];
+		_packed[i] = PaletteExpander::packColor(_colors[i]);
+	}
+
+	// Only colors which were defined by the previous color table need to be cleared
+	if (size < _size)
+		clearFrom(size);
+
+	_size = static_cast<std::uint16_t>(size);
+	return true;
+}
+
+/**
+ * Makes all colors black and the palette empty.
+ */
+void Palette::clear()
+{
+	clearFrom(0);
+	_size = 0;
+}
+
+/**
+ * Returns the number of colors defined by the color table.
+ *
+ * @return The number of colors.
+ */
+std::uint16_t Palette::getSize() const
+{
+	return _size;
+}
+
+bool Palette::isEmpty() const
+{
+	return _size == 0;
+}
+
+const Color* Palette::getColors() const
+{
+	return _colors;
+}
+
+const std::uint32_t* Palette::getPacked() const
+{
+	return _packed;
+}
+
+void Palette::clearFrom(std::size_t index)
+{
+	for (std::size_t i = index; i < PALETTE_SIZE; ++i)
+	{
+		_colors[i].red = _colors[i].green = _colors[i].blue = 0;
+		_packed[i] = PaletteExpander::packColor(_colors[i]);
+	}
+}
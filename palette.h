@@ -0,0 +1,43 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "data_buffer.h"
+#include "utils.h"
+
+const std::size_t PALETTE_SIZE = 256;
+
+/**
+ * Color table of fixed size of 256 colors. Colors which are not defined by the color
+ * table are black, so any 8-bit index can be looked up without bounds checks.
+ * Colors are also kept packed into BGRA words for expansion kernels.
+ */
+class Palette
+{
+public:
+	Palette();
+
+	bool load(const DataView& colorTableBuffer);
+	void clear();
+
+	std::uint16_t getSize() const;
+	bool isEmpty() const;
+	const Color* getColors() const;
+	const std::uint32_t* getPacked() const;
+
+	const Color& operator [](std::uint8_t index) const
+	{
+		return _colors[index];
+	}
+
+private:
+	void clearFrom(std::size_t index);
+
+	std::uint16_t _size;
+	Color _colors[PALETTE_SIZE];
+	alignas(16) std::uint32_t _packed[PALETTE_SIZE];
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include "palette_expander.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PALETTE_EXPANDER_X86
+#include <immintrin.h>
+#endif
+
+using ExpandFunction = void (*)(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output);
+
+static void expandBgrScalar(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output)
+{
+	for (std::size_t i = 0; i < count; ++i, output += 3)
+	{
+		std::uint32_t color = palette[indices[i]];
+		output[0] = static_cast<std::uint8_t>(color);
+		output[1] = static_cast<std::uint8_t>(color >> 8);
+		output[2] = static_cast<std::uint8_t>(color >> 16);
+	}
+}
+
+static void expandBgraScalar(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output)
+{
+	for (std::size_t i = 0; i < count; ++i, output += 4)
+	{
+		std::uint32_t color = palette[indices[i]];
+		output[0] = static_cast<std::uint8_t>(color);
+		output[1] = static_cast<std::uint8_t>(color >> 8);
+		output[2] = static_cast<std::uint8_t>(color >> 16);
+		output[3] = static_cast<std::uint8_t>(color >> 24);
+	}
+}
+
+#ifdef PALETTE_EXPANDER_X86
+// Packs four BGRA pixels in every 128-bit lane into twelve BGR bytes at the start of the lane
+#define BGR_SHUFFLE 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+
+__attribute__((target("sse4.1"))) static __m128i lookupSse41(const std::uint8_t* indices, const std::uint32_t* palette)
+{
+	__m128i colors = _mm_cvtsi32_si128(static_cast<int>(palette[indices[0]]));
+	colors = _mm_insert_epi32(colors, static_cast<int>(palette[indices[1]]), 1);
+	colors = _mm_insert_epi32(colors, static_cast<int>(palette[indices[2]]), 2);
+	return _mm_insert_epi32(colors, static_cast<int>(palette[indices[3]]), 3);
+}
+
+__attribute__((target("sse4.1"))) static void expandBgrSse41(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output)
+{
+	const __m128i shuffle = _mm_setr_epi8(BGR_SHUFFLE);
+
+	// Every store writes 16 bytes but only 12 of them are valid, the rest is overwritten by the next store
+	std::size_t i = 0;
+	for (; i + 6 <= count; i += 4)
+	{
+		__m128i packed = _mm_shuffle_epi8(lookupSse41(indices + i, palette), shuffle);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 3), packed);
+	}
+
+	expandBgrScalar(indices + i, count - i, palette, output + i * 3);
+}
+
+__attribute__((target("sse4.1"))) static void expandBgraSse41(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 4), lookupSse41(indices + i, palette));
+
+	expandBgraScalar(indices + i, count - i, palette, output + i * 4);
+}
+
+__attribute__((target("avx2"))) static __m256i lookupAvx2(const std::uint8_t* indices, const std::uint32_t* palette)
+{
+	__m128i indices8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices));
+	return _mm256_i32gather_epi32(reinterpret_cast<const int*>(palette), _mm256_cvtepu8_epi32(indices8), 4);
+}
+
+__attribute__((target("avx2"))) static void expandBgrAvx2(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output)
+{
+	const __m256i shuffle = _mm256_setr_epi8(BGR_SHUFFLE, BGR_SHUFFLE);
+
+	// Each lane is stored separately as 16 bytes of which 12 are valid, so the last store needs 4 spare bytes
+	std::size_t i = 0;
+	for (; i + 10 <= count; i += 8)
+	{
+		__m256i packed = _mm256_shuffle_epi8(lookupAvx2(indices + i, palette), shuffle);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 3), _mm256_castsi256_si128(packed));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 3 + 12), _mm256_extracti128_si256(packed, 1));
+	}
+
+	expandBgrScalar(indices + i, count - i, palette, output + i * 3);
+}
+
+__attribute__((target("avx2"))) static void expandBgraAvx2(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output)
+{
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i * 4), lookupAvx2(indices + i, palette));
+
+	expandBgraScalar(indices + i, count - i, palette, output + i * 4);
+}
+#endif
+
+static PaletteKernel detectKernel()
+{
+#ifdef PALETTE_EXPANDER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return PALETTE_KERNEL_AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return PALETTE_KERNEL_SSE41;
+#endif
+	return PALETTE_KERNEL_SCALAR;
+}
+
+static PaletteKernel& currentKernel()
+{
+	static PaletteKernel kernel = detectKernel();
+	return kernel;
+}
+
+static ExpandFunction bgrFunction(PaletteKernel kernel)
+{
+	switch (kernel)
+	{
+#ifdef PALETTE_EXPANDER_X86
+		case PALETTE_KERNEL_AVX2:
+			return expandBgrAvx2;
+		case PALETTE_KERNEL_SSE41:
+			return expandBgrSse41;
+#endif
+		default:
+			return expandBgrScalar;
+	}
+}
+
+static ExpandFunction bgraFunction(PaletteKernel kernel)
+{
+	switch (kernel)
+	{
+#ifdef PALETTE_EXPANDER_X86
+		case PALETTE_KERNEL_AVX2:
+			return expandBgraAvx2;
+		case PALETTE_KERNEL_SSE41:
+			return expandBgraSse41;
+#endif
+		default:
+			return expandBgraScalar;
+	}
+}
+
+/**
+ * Expands indices into packed BGR pixels, 3 bytes per pixel.
+ *
+ * @param indices The indices to expand.
+ * @param count The number of indices.
+ * @param palette 256 packed colors.
+ * @param output The buffer for count * 3 bytes.
+ */
+void PaletteExpander::expandBgr(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output)
+{
+	bgrFunction(currentKernel())(indices, count, palette, output);
+}
+
+/**
+ * Expands indices into packed BGRA pixels, 4 bytes per pixel.
+ *
+ * @param indices The indices to expand.
+ * @param count The number of indices.
+ * @param palette 256 packed colors.
+ * @param output The buffer for count * 4 bytes.
+ */
+void PaletteExpander::expandBgra(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output)
+{
+	bgraFunction(currentKernel())(indices, count, palette, output);
+}
+
+/**
+ * Packs opaque color into the palette entry.
+ *
+ * @param color The color to pack.
+ *
+ * @return Packed BGRA color.
+ */
+std::uint32_t PaletteExpander::packColor(const Color& color)
+{
+	return static_cast<std::uint32_t>(color.blue)
+		| (static_cast<std::uint32_t>(color.green) << 8)
+		| (static_cast<std::uint32_t>(color.red) << 16)
+		| (0xFFu << 24);
+}
+
+/**
+ * Returns the kernel which is used for expansion.
+ *
+ * @return The kernel.
+ */
+PaletteKernel PaletteExpander::getKernel()
+{
+	return currentKernel();
+}
+
+/**
+ * Selects the kernel used for expansion instead of the fastest one, for example
+ * to compare the kernels.
+ *
+ * @param kernel The kernel to use.
+ *
+ * @return True if the kernel is supported by the CPU and was selected, otherwise false.
+ */
+bool PaletteExpander::setKernel(PaletteKernel kernel)
+{
+	if (!isSupported(kernel))
+		return false;
+
+	currentKernel() = kernel;
+	return true;
+}
+
+/**
+ * Returns whether the kernel can run on this CPU.
+ *
+ * @param kernel The kernel.
+ *
+ * @return True if supported, otherwise false.
+ */
+bool PaletteExpander::isSupported(PaletteKernel kernel)
+{
+	PaletteKernel best = detectKernel();
+	return kernel <= best;
+}
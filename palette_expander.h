@@ -0,0 +1,35 @@
+#ifndef PALETTE_EXPANDER_H
+#define PALETTE_EXPANDER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "utils.h"
+
+enum PaletteKernel
+{
+	PALETTE_KERNEL_SCALAR,
+	PALETTE_KERNEL_SSE41,
+	PALETTE_KERNEL_AVX2
+};
+
+/**
+ * This class expands palette indices into packed BGR or BGRA pixels. Palette is given
+ * as 256 colors packed into 32-bit words with blue in the lowest byte and alpha in
+ * the highest byte. The fastest kernel supported by the CPU is selected at runtime,
+ * all kernels produce exactly the same output.
+ */
+class PaletteExpander
+{
+public:
+	static void expandBgr(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output);
+	static void expandBgra(const std::uint8_t* indices, std::size_t count, const std::uint32_t* palette, std::uint8_t* output);
+
+	static std::uint32_t packColor(const Color& color);
+
+	static PaletteKernel getKernel();
+	static bool setKernel(PaletteKernel kernel);
+	static bool isSupported(PaletteKernel kernel);
+};
+
+#endif
@@ -0,0 +1,59 @@
+#include "sub_block_reader.h"
+
+SubBlockReader::SubBlockReader(const DataView& buffer, std::size_t offset) :
+	_buffer(buffer.getData()), _bufferSize(buffer.getSize()), _pos(offset), _terminated(false), _valid(true)
+{
+}
+
+/**
+ * Moves to the next sub-block in the chain.
+ *
+ * @param data Pointer to the data of the sub-block.
+ * @param size The size of the data of the sub-block.
+ *
+ * @return True if there is the next sub-block, false if the terminator was hit or the chain is cut short.
+ */
+bool SubBlockReader::next(const std::uint8_t*& data, std::size_t& size)
+{
+	if (_terminated || !_valid)
+		return false;
+
+	if (_pos >= _bufferSize)
+	{
+		_valid = false;
+		return false;
+	}
+
+	std::uint8_t blockSize = _buffer[_pos++];
+	if (blockSize == 0)
+	{
+		_terminated = true;
+		return false;
+	}
+
+	if (_pos + blockSize > _bufferSize)
+	{
+		_valid = false;
+		return false;
+	}
+
+	data = _buffer + _pos;
+	size = blockSize;
+	_pos += blockSize;
+	return true;
+}
+
+/**
+ * Skips all remaining sub-blocks including the terminator.
+ *
+ * @return True if the terminator was found, otherwise false.
+ */
+bool SubBlockReader::skipToEnd()
+{
+	const std::uint8_t* data;
+	std::size_t size;
+	while (next(data, size))
+		;
+
+	return _terminated;
+}
@@ -0,0 +1,31 @@
+#ifndef SUB_BLOCK_READER_H
+#define SUB_BLOCK_READER_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include "data_buffer.h"
+
+/**
+ * This class iterates over the chain of data sub-blocks in the buffer. Every
+ * sub-block is made of size byte followed by 1-255 bytes of data and the chain is
+ * terminated by sub-block of size 0. Data are not copied, the reader returns
+ * pointers into the original buffer.
+ */
+class SubBlockReader
+{
+public:
+	SubBlockReader(const DataView& buffer, std::size_t offset);
+
+	bool next(const std::uint8_t*& data, std::size_t& size);
+	bool skipToEnd();
+
+private:
+	const std::uint8_t* _buffer;
+	std::size_t _bufferSize;
+	std::size_t _pos;
+	bool _terminated;
+	bool _valid;
+};
+
+#endif
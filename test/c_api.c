@@ -0,0 +1,112 @@
+/*
+ * Checks that the library can be used from C. Converts the GIF given as the only
+ * argument by the file and the memory functions and compares their outputs.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "gif2bmp.h"
+
+static uint8_t *readInput(const char *fileName, size_t *size)
+{
+	FILE *file = fopen(fileName, "rb");
+	uint8_t *data = NULL;
+	long fileSize;
+
+	if (file == NULL)
+		return NULL;
+
+	if (fseek(file, 0, SEEK_END) == 0 && (fileSize = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0)
+	{
+		data = malloc((size_t)fileSize);
+		if (data != NULL && fread(data, 1, (size_t)fileSize, file) != (size_t)fileSize)
+		{
+			free(data);
+			data = NULL;
+		}
+		*size = (size_t)fileSize;
+	}
+
+	fclose(file);
+	return data;
+}
+
+static uint8_t *convertFile(const char *fileName, const tGIF2BMPOPTIONS *options, size_t *size)
+{
+	FILE *inputFile = fopen(fileName, "rb");
+	FILE *outputFile = tmpfile();
+	uint8_t *data = NULL;
+	long fileSize;
+
+	if (inputFile != NULL && outputFile != NULL && gif2bmpEx(NULL, inputFile, outputFile, options) == 0
+		&& (fileSize = ftell(outputFile)) > 0 && fseek(outputFile, 0, SEEK_SET) == 0)
+	{
+		data = malloc((size_t)fileSize);
+		if (data != NULL && fread(data, 1, (size_t)fileSize, outputFile) != (size_t)fileSize)
+		{
+			free(data);
+			data = NULL;
+		}
+		*size = (size_t)fileSize;
+	}
+
+	if (inputFile != NULL)
+		fclose(inputFile);
+	if (outputFile != NULL)
+		fclose(outputFile);
+	return data;
+}
+
+int main(int argc, char **argv)
+{
+	tGIF2BMPOPTIONS options;
+	tGIF2BMPCONTEXT *context;
+	uint8_t *input, *expected, *output = NULL, *allocated = NULL;
+	size_t inputSize = 0, expectedSize = 0, outputSize = 0, allocatedSize = 0;
+	int failed = 1;
+
+	if (argc != 2)
+	{
+		fprintf(stderr, "Usage: %s <gif file>\n", argv[0]);
+		return 1;
+	}
+
+	context = gif2bmpContextCreate();
+	gif2bmpDefaultOptions(&options);
+	options.context = context;
+
+	input = readInput(argv[1], &inputSize);
+	expected = convertFile(argv[1], &options, &expectedSize);
+	if (input == NULL || expected == NULL)
+		goto cleanup;
+
+	// Size query without any output memory
+	if (gif2bmpMemory(NULL, input, inputSize, NULL, &outputSize, &options) != GIF2BMP_BUFFER_TOO_SMALL || outputSize != expectedSize)
+		goto cleanup;
+
+	output = malloc(outputSize);
+	if (output == NULL || gif2bmpMemory(NULL, input, inputSize, output, &outputSize, &options) != 0
+		|| outputSize != expectedSize || memcmp(output, expected, expectedSize) != 0)
+		goto cleanup;
+
+	if (gif2bmpMemoryAlloc(NULL, input, inputSize, &allocated, &allocatedSize, &options) != 0
+		|| allocatedSize != expectedSize || memcmp(allocated, expected, expectedSize) != 0)
+		goto cleanup;
+
+	failed = 0;
+
+cleanup:
+	gif2bmpFree(allocated);
+	free(output);
+	free(expected);
+	free(input);
+	gif2bmpContextDestroy(context);
+
+	if (failed)
+	{
+		fprintf(stderr, "%s: C API conversion failed\n", argv[1]);
+		return 1;
+	}
+
+	return 0;
+}
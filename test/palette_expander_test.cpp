@@ -0,0 +1,74 @@
+// Checks that every kernel of PaletteExpander supported by this CPU gives exactly
+// the same output as the scalar kernel, for all lengths up to several vectors
+// so that every tail is covered, and that nothing is written past the output.
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "palette_expander.h"
+
+static const std::size_t MAX_COUNT = 256;
+static const std::size_t GUARD_SIZE = 64;
+static const std::uint8_t GUARD_BYTE = 0xA5;
+
+using ExpandFunction = void (*)(const std::uint8_t*, std::size_t, const std::uint32_t*, std::uint8_t*);
+
+static std::vector<std::uint8_t> expand(ExpandFunction function, PaletteKernel kernel, const std::vector<std::uint8_t>& indices,
+	std::size_t offset, std::size_t count, const std::vector<std::uint32_t>& palette, std::size_t bytesPerPixel)
+{
+	PaletteExpander::setKernel(kernel);
+
+	std::vector<std::uint8_t> output(count * bytesPerPixel + GUARD_SIZE, GUARD_BYTE);
+	function(indices.data() + offset, count, palette.data(), output.data());
+	return output;
+}
+
+static bool check(const char* name, ExpandFunction function, std::size_t bytesPerPixel, PaletteKernel kernel,
+	const std::vector<std::uint8_t>& indices, const std::vector<std::uint32_t>& palette)
+{
+	// Input is read from unaligned offsets too
+	for (std::size_t offset = 0; offset < 4; ++offset)
+	{
+		for (std::size_t count = 0; count <= MAX_COUNT; ++count)
+		{
+			std::vector<std::uint8_t> expected = expand(function, PALETTE_KERNEL_SCALAR, indices, offset, count, palette, bytesPerPixel);
+			std::vector<std::uint8_t> output = expand(function, kernel, indices, offset, count, palette, bytesPerPixel);
+			if (output != expected)
+			{
+				fprintf(stderr, "%s: kernel %d differs from scalar for %zu pixels at offset %zu\n", name, static_cast<int>(kernel), count, offset);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int main()
+{
+	std::mt19937 random(1);
+	std::vector<std::uint8_t> indices(MAX_COUNT + 4);
+	for (auto& index : indices)
+		index = static_cast<std::uint8_t>(random());
+
+	// Alpha is random as well, so the BGR kernels have to drop it
+	std::vector<std::uint32_t> palette(256);
+	for (auto& color : palette)
+		color = static_cast<std::uint32_t>(random());
+
+	bool passed = true;
+	for (PaletteKernel kernel : {PALETTE_KERNEL_SCALAR, PALETTE_KERNEL_SSE41, PALETTE_KERNEL_AVX2})
+	{
+		if (!PaletteExpander::isSupported(kernel))
+		{
+			printf("kernel %d is not supported, skipped\n", static_cast<int>(kernel));
+			continue;
+		}
+
+		passed = check("expandBgr", PaletteExpander::expandBgr, 3, kernel, indices, palette) && passed;
+		passed = check("expandBgra", PaletteExpander::expandBgra, 4, kernel, indices, palette) && passed;
+	}
+
+	return passed ? 0 : 1;
+}
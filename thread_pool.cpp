@@ -0,0 +1,86 @@
+#include <memory>
+
+#include "thread_pool.h"
+
+/**
+ * Creates the pool and starts its threads.
+ *
+ * @param threadCount The number of threads. If 0, the number of CPUs is used.
+ */
+ThreadPool::ThreadPool(std::size_t threadCount) : _threads(), _tasks(), _mutex(), _condition(), _stopping(false)
+{
+	if (threadCount == 0)
+		threadCount = defaultThreadCount();
+
+	for (std::size_t i = 0; i < threadCount; ++i)
+		_threads.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_condition.notify_all();
+	for (auto& thread : _threads)
+		thread.join();
+}
+
+/**
+ * Submits the task to be run by one of the threads.
+ *
+ * @param task The task to run.
+ *
+ * @return Future which is ready once the task is finished.
+ */
+std::future<void> ThreadPool::submit(const std::function<void()>& task)
+{
+	auto packagedTask = std::make_shared<std::packaged_task<void()>>(task);
+	std::future<void> result = packagedTask->get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push([packagedTask]() { (*packagedTask)(); });
+	}
+
+	_condition.notify_one();
+	return result;
+}
+
+std::size_t ThreadPool::getThreadCount() const
+{
+	return _threads.size();
+}
+
+/**
+ * Returns the number of threads used if the count is not specified, which is the number of CPUs.
+ *
+ * @return The number of threads.
+ */
+std::size_t ThreadPool::defaultThreadCount()
+{
+	std::size_t threadCount = std::thread::hardware_concurrency();
+	return threadCount ? threadCount : 1;
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+			if (_tasks.empty())
+				return;
+
+			task = std::move(_tasks.front());
+			_tasks.pop();
+		}
+
+		task();
+	}
+}
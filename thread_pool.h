@@ -0,0 +1,42 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed-size pool of worker threads which run submitted tasks in the order
+ * in which they were submitted. Threads are joined when the pool is destroyed.
+ */
+class ThreadPool
+{
+public:
+	ThreadPool(std::size_t threadCount);
+	ThreadPool(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	ThreadPool& operator =(const ThreadPool&) = delete;
+
+	std::future<void> submit(const std::function<void()>& task);
+
+	std::size_t getThreadCount() const;
+
+	static std::size_t defaultThreadCount();
+
+private:
+	void work();
+
+	std::vector<std::thread> _threads;
+	std::queue<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	bool _stopping;
+};
+
+#endif
@@ -1,70 +1,90 @@
+#include <cerrno>
+
+#include <unistd.h>
+
+#include "arena.h"
 #include "utils.h"
 
 /**
- * Returns the size of the given file. This function does not modify
- * the position in the file.
+ * Reads the contents of the stream from the current position until the end of
+ * the stream and stores it into vector buffer. Works also for the streams which
+ * cannot be seeked, like pipes. Reads go through readAvailable(), so the same
+ * precondition applies.
  *
- * @param file The file to check.
- * @param size The size of the file.
+ * @param file Stream to read.
+ * @param result The vector where to store result.
  *
- * @return True if function was successful, otherwise false.
+ * @return True if read was successful, otherwise false.
  */
-bool fileSize(FILE* file, std::size_t& size)
+template <typename Allocator> bool readStream(FILE* file, std::vector<std::uint8_t, Allocator>& result)
 {
 	if (file == nullptr)
 		return false;
 
-	// Store old position in the file
-	long oldPos = ftell(file);
-	if (oldPos == -1L)
-		return false;
+	const std::size_t chunkSize = 64 * 1024;
 
-	if (fseek(file, 0, SEEK_END) == -1)
-		return false;
+	result.clear();
+	while (true)
+	{
+		std::size_t oldSize = result.size();
+		result.resize(oldSize + chunkSize);
 
-	size = ftell(file);
+		std::size_t bytesRead = 0;
+		if (!readAvailable(file, result.data() + oldSize, chunkSize, bytesRead))
+			return false;
+
+		result.resize(oldSize + bytesRead);
+		if (bytesRead == 0)
+			break;
+	}
 
-	// Restore old position
-	fseek(file, oldPos, SEEK_SET);
 	return true;
 }
 
+template bool readStream(FILE* file, std::vector<std::uint8_t>& result);
+template bool readStream(FILE* file, ArenaVector<std::uint8_t>& result);
+
 /**
- * Reads the contents of the file and stores it into vector buffer. Modifies the position in the file.
+ * Reads whatever part of the requested bytes is available in the stream. Unlike fread(),
+ * which waits until all bytes of the pipe arrive, this returns as soon as any data
+ * are there. Streams without the file descriptor are read by fread().
  *
- * @param file File to read.
- * @param offset Offset to read from.
- * @param count The number of bytes to read.
- * @param result The vector where to store result.
+ * The file descriptor is read directly, so bytes which stdio has already buffered
+ * are skipped. The stream must not be read by stdio before, all reads of it have to
+ * go through this function.
+ *
+ * @param file Stream to read.
+ * @param data The buffer where to store the bytes.
+ * @param size The maximum number of bytes to read.
+ * @param bytesRead The number of bytes read, zero at the end of the stream.
  *
  * @return True if read was successful, otherwise false.
  */
-bool readFile(FILE* file, std::size_t offset, std::size_t count, std::vector<std::uint8_t>& result)
+bool readAvailable(FILE* file, std::uint8_t* data, std::size_t size, std::size_t& bytesRead)
 {
 	if (file == nullptr)
 		return false;
 
-	std::size_t size;
-	if (!fileSize(file, size))
-		return false;
-
-	// Check so we do not read bytes out of boundaries
-	count = offset + count >= size ? size - offset : count;
+	int fd = fileno(file);
+	if (fd == -1)
+	{
+		bytesRead = fread(data, 1, size, file);
+		return ferror(file) == 0;
+	}
 
-	// We need to resize the buffer, so we are sure there are already enough bytes pre-allocated
-	result.clear();
-	result.resize(count);
-
-	if (fseek(file, offset, SEEK_SET) == -1)
-		return false;
+	ssize_t result;
+	do
+		result = read(fd, data, size);
+	while (result == -1 && errno == EINTR);
 
-	if (fread(result.data(), 1, count, file) != count)
+	if (result == -1)
 		return false;
 
+	bytesRead = static_cast<std::size_t>(result);
 	return true;
 }
 
-bool writeFile(FILE* file, std::size_t offset, const std::vector<std::uint8_t>& data)
+template <typename Allocator> bool writeFile(FILE* file, std::size_t offset, const std::vector<std::uint8_t, Allocator>& data)
 {
 	if (file == nullptr)
 		return false;
@@ -78,6 +98,26 @@ bool writeFile(FILE* file, std::size_t offset, const std::vector<std::uint8_t>&
 	return true;
 }
 
+template bool writeFile(FILE* file, std::size_t offset, const std::vector<std::uint8_t>& data);
+template bool writeFile(FILE* file, std::size_t offset, const ArenaVector<std::uint8_t>& data);
+
+/**
+ * Converts the number to decimal string padded with leading zeroes.
+ *
+ * @param number The number to convert.
+ * @param minDigits The minimal number of digits.
+ *
+ * @return String representation of the number.
+ */
+std::string numberToString(std::uint64_t number, std::size_t minDigits)
+{
+	std::string str = std::to_string(number);
+	if (str.length() < minDigits)
+		str.insert(0, minDigits - str.length(), '0');
+
+	return str;
+}
+
 std::uint64_t alignDown(std::uint64_t value, std::uint64_t alignment)
 {
 	return (value & ~(alignment - 1));
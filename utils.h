@@ -3,21 +3,23 @@
 
 #include <cstdint>
 #include <cstdio>
+#include <string>
 #include <vector>
 
 struct Color
 {
 	Color() : red(0), green(0), blue(0) {}
-	Color(const Color& color) : red(color.red), green(color.green), blue(color.blue) {}
 
 	std::uint8_t red;
 	std::uint8_t green;
 	std::uint8_t blue;
 };
 
-bool fileSize(FILE* file, std::size_t& size);
-bool readFile(FILE* file, std::size_t offset, std::size_t count, std::vector<std::uint8_t>& result);
-bool writeFile(FILE* file, std::size_t offset, const std::vector<std::uint8_t>& data);
+template <typename Allocator> bool readStream(FILE* file, std::vector<std::uint8_t, Allocator>& result);
+bool readAvailable(FILE* file, std::uint8_t* data, std::size_t size, std::size_t& bytesRead);
+template <typename Allocator> bool writeFile(FILE* file, std::size_t offset, const std::vector<std::uint8_t, Allocator>& data);
+
+std::string numberToString(std::uint64_t number, std::size_t minDigits);
 
 std::uint64_t alignDown(std::uint64_t value, std::uint64_t alignment);
 std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment);